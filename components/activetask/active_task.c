@@ -15,10 +15,43 @@
 #include <sys/sysinfo.h>
 #include <sched.h>
 #include <ctype.h>
+#include <time.h>
 #endif /* __linux__ */
 
 #include "linux_macros.h"
+#include "blk_track.h"
 #include "active_task.h"
+#include "task_executor.h"
+
+/* stopping requested, or timers expired */
+#define task_interrupted(task) \
+    (0 != atomic_load(&(task)->timer_pending) \
+    || TASK_STATE_STOPPING == atomic_load(&(task)->run_state))
+
+/* release msg blocks left in queues, single consumer only */
+static void task_drain_queues(active_task *task)
+{
+    msgblk *mblks[TASK_BATCH_MAX];
+    for (int i = 0; i < TASK_QUEUE_NUM; i++) {
+        int num = TASK_BATCH_MAX;
+        while (NULL != task->queues[i] && INNER_RES_OK == msgblk_pop_circ_queue_n(
+                task->queues[i], mblks, &num, QUEUE_NO_WAIT)) {
+            KRNL_DEBUG("task %s drop %d messages\n", task->name, num);
+            for (int j = 0; j < num; j++) msgblk_free(mblks[j]);   // decrease refer
+            num = TASK_BATCH_MAX;
+        }
+    }
+}
+
+/* end of svc in task context: release pending messages then on_fini */
+static void task_exit(active_task *task)
+{
+    task_drain_queues(task);
+    if (NULL != task->on_fini) {
+        KRNL_DEBUG("task %s call on_fini\n", task->name);
+        task->on_fini(task);
+    }
+}
 
 #if defined(__linux__) || defined(__linux)
 static void *dft_task_func(void *param)
@@ -28,15 +61,84 @@ static void dft_task_func(void *param)
 {
     active_task *task = (active_task *)param;
     KRNL_DEBUG("task %s ready to run\n", task->name);
+    blk_track_set_owner(task->name);
     task->task_svc(task);
+    task_exit(task);
+    // blocks cached by this thread back to pools
+    msgblk_thread_flush();
+    datablk_thread_flush();
     #if defined(__linux__) || defined(__linux)
     pthread_exit(NULL);
     return param;
     #elif defined(CONFIG_FreeRTOS)
+    // last touch of task, it may be freed once svc_done is seen
+    TaskHandle_t stopper = task->stopper;
+    atomic_store(&task->svc_done, true);
+    if (NULL != stopper) xTaskNotifyGive(stopper);
     vTaskDelete(NULL);
     #endif /* _ESP_PLATFORM */
 }
 
+/* wake up the task thread, or make a pooled task runnable */
+static void task_wakeup(void *ctx)
+{
+    active_task *task = (active_task *)ctx;
+    if (TASK_RUN_POOLED == task->run_mode) task_executor_kick(task);
+    else os_event_notify(&task->event);
+}
+
+/* called in timer wheel task, hand the timer over to its task */
+static void task_timer_expire(at_timer *timer, void *arg)
+{
+    active_task *task = (active_task *)arg;
+    atomic_fetch_or(&task->timer_pending, 1U << (timer - task->timers));
+    task_wakeup(task);
+}
+
+static void task_stop_timers(active_task *task)
+{
+    for (int i = 0; i < TASK_TIMER_NUM; i++) timer_wheel_del(&task->timers[i]);
+    atomic_store(&task->timer_pending, 0);
+}
+
+/* release queues once no put in flight, run_state set off RUNNING before */
+static void task_delete_queues(active_task *task)
+{
+    // a put counted after the state changed backs off, wait for those before
+    while (0 != atomic_load(&task->puts)) {
+        task_drain_queues(task);    // room for puts blocked on a full queue
+        delay_ms(1);
+    }
+    task_drain_queues(task);
+    for (int i = 0; i < TASK_QUEUE_NUM; i++) {
+        if (NULL != task->queues[i]) circ_queue_delete(task->queues[i]);
+        task->queues[i] = NULL;
+    }
+    task->queue = NULL;
+}
+
+/* undo task_begin after queues created */
+static void task_begin_fail(active_task *task)
+{
+    atomic_store(&task->run_state, TASK_STATE_STOPPING);
+    task_stop_timers(task);
+    task_delete_queues(task);
+    atomic_store(&task->run_state, TASK_STATE_STOPPED);
+}
+
+/* push into an input queue of a running task, counted so that its queues are kept */
+static at_error_t task_push(active_task *task, task_queue_prio prio, msgblk *mblk, int wait_ms)
+{
+    at_error_t res = TASK_NOT_RUNNING;
+    atomic_fetch_add(&task->puts, 1);
+    if (TASK_STATE_RUNNING == atomic_load(&task->run_state)) {
+        circ_queue *queue = task->queues[prio];
+        res = NULL == queue ? INNER_INVAILD_PARAM : msgblk_push_circ_queue(queue, mblk, wait_ms);
+    }
+    atomic_fetch_sub_explicit(&task->puts, 1, memory_order_release);
+    return res;
+}
+
 /***
  * @description : start running of an active task
  * @param        {active_task} *task - pointer to active task
@@ -45,47 +147,92 @@ static void dft_task_func(void *param)
 at_error_t dft_task_begin(active_task *task)
 {
     if (NULL == task) return INNER_INVAILD_PARAM;
+    int state = TASK_STATE_STOPPED;
+    if (!atomic_compare_exchange_strong(&task->run_state, &state, TASK_STATE_STARTING)) {
+        KRNL_ERROR("task %s not stopped yet\n", task->name);
+        return TASK_FAILED_CREATE;
+    }
     KRNL_DEBUG("task %s begin\n", task->name);
 
-    // create queue in need
-    if (task->queue_length > 0) {
-        if (NULL == (task->queue = circ_queue_create(task->queue_length))) {
-            KRNL_ERROR("task %s failed to init queue\n", task->name);
+    // create queues in need, NORMAL is SPSC only if asked and fed by one upstream
+    task->queue_lengths[TASK_QUEUE_NORMAL] = task->queue_length;
+    bool spsc = 0 != (task->queue_flags & QUEUE_F_SPSC);
+    int upstream_num = atomic_load(&task->upstream_num);
+    if (spsc && 1 < upstream_num) {
+        KRNL_ERROR("task %s has %d upstreams, queue not SPSC\n", task->name, upstream_num);
+        spsc = false;
+    }
+    for (int i = 0; i < TASK_QUEUE_NUM; i++) {
+        if (0 >= task->queue_lengths[i]) continue;
+        int flags = task->queue_flags & ~QUEUE_F_SPSC;
+        if (TASK_QUEUE_NORMAL == i && spsc) flags |= QUEUE_F_SPSC;
+        if (NULL == (task->queues[i] = circ_queue_create(task->queue_lengths[i], flags))) {
+            KRNL_ERROR("task %s failed to init queue %d\n", task->name, i);
+            task_begin_fail(task);
             return TASK_FAILED_QUEUE;
         }
     }
+    task->queue = task->queues[TASK_QUEUE_NORMAL];
+    // wait on task event for all queues and timers
+    for (int i = 0; i < TASK_QUEUE_NUM; i++) {
+        if (NULL != task->queues[i])
+            circ_queue_set_notify(task->queues[i], task_wakeup, task);
+    }
+    // queues ready, take puts from now on, on_init may put too
+    atomic_store(&task->run_state, TASK_STATE_RUNNING);
 
     // on_init
     if (NULL != task->on_init) {
         at_error_t res;
         if (INNER_RES_OK != (res = task->on_init(task))) {
             KRNL_ERROR("task %s exit due to init\n", task->name);
+            task_begin_fail(task);
             return res;
         }
         KRNL_ERROR("task %s on_init ok\n", task->name);
     }
 
-    // reset last scheduled
+    // reset last scheduled, schedule by timer wheel if it's running
     task->last_scheduled = get_sys_ms();
+    task->sched_timer = 0 < task->schedule_ms && NULL != task->on_schedule
+        && INNER_RES_OK == timer_wheel_add(&task->timers[TASK_TIMER_SCHEDULE],
+            task->schedule_ms, task->schedule_ms, AT_TIMER_FIXED_RATE);
 
+    if (TASK_RUN_POOLED == task->run_mode) {
+        // no thread of its own, run on workers of executor
+        if (0 < task->schedule_ms && NULL != task->on_schedule && !task->sched_timer)
+            KRNL_ERROR("task %s on_schedule needs timer wheel\n", task->name);
+        at_error_t res = task_executor_attach(task);
+        if (INNER_RES_OK != res) {
+            KRNL_ERROR("task %s failed to attach executor\n", task->name);
+            task_begin_fail(task);
+        }
+        return res;
+    }
+
+    atomic_store(&task->svc_done, false);
 #if defined(__linux__) || defined(__linux)
-    // TODO
     pthread_attr_t attr;
     pthread_attr_init(&attr);
     struct sched_param s_param = {.sched_priority = task->priority};
     pthread_attr_setschedparam(&attr, &s_param); // priority
     pthread_attr_setstacksize(&attr, (size_t)task->stack_depth); // stack size
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);  //detached
-    pthread_create(&task->task_handler, &attr, dft_task_func, (void *)task);
+    // joinable, task_stop joins it
+    int result = pthread_create(&task->task_handler, &attr, dft_task_func, (void *)task);
+    pthread_attr_destroy(&attr);
+    if (0 != result) {
+        KRNL_ERROR("task %s failed to create thread\n", task->name);
+        task_begin_fail(task);
+        return TASK_FAILED_CREATE;
+    }
 
     cpu_set_t mask;
     CPU_ZERO(&mask);
     CPU_SET(task->core_id, &mask);
     pthread_setaffinity_np(task->task_handler, sizeof(mask), &mask);  //cpu core
-
-    pthread_detach(task->task_handler);
 #elif defined(CONFIG_FreeRTOS)
     // FreeRTOS task
+    task->stopper = NULL;
     BaseType_t result = xTaskCreatePinnedToCore(dft_task_func, task->name,
             task->stack_depth, (void *)task, task->priority,
             &task->task_handler, task->core_id);
@@ -94,6 +241,141 @@ at_error_t dft_task_begin(active_task *task)
     return INNER_RES_OK;
 }
 
+/* pop from the queue of highest priority which is not empty */
+static int task_try_recv(active_task *task, msgblk **mblks, int num)
+{
+    for (int i = 0; i < TASK_QUEUE_NUM; i++) {
+        int n = num;
+        if (NULL != task->queues[i] && INNER_RES_OK == msgblk_pop_circ_queue_n(
+                task->queues[i], mblks, &n, QUEUE_NO_WAIT))
+            return n;
+    }
+    return 0;
+}
+
+/* wait once on all input queues and timers, return number of msg blocks got */
+static int task_recv(active_task *task, msgblk **mblks, int num, int wait_ms)
+{
+    int n = task_try_recv(task, mblks, num);
+    if (0 < n || QUEUE_NO_WAIT == wait_ms || 0 > wait_ms) return n;
+    if (task_interrupted(task)) return 0;
+    unsigned long deadline = get_sys_ms() + wait_ms;
+    for (;;) {
+        int left = QUEUE_WAIT_FOREVER;
+        if (QUEUE_WAIT_FOREVER != wait_ms) {
+            left = (int)(deadline - get_sys_ms());
+            if (0 >= left) break;
+        }
+        os_event_prepare(&task->event);
+        // check again after registered, producer may have pushed just now
+        if (0 < (n = task_try_recv(task, mblks, num)) || task_interrupted(task)) {
+            os_event_cancel(&task->event);
+            break;
+        }
+        os_event_wait(&task->event, left);
+        if (0 < (n = task_try_recv(task, mblks, num)) || task_interrupted(task)) break;
+    }
+    return n;
+}
+
+/* receive timeout bounded by the next schedule if not on timer wheel */
+static int task_recv_timeout(active_task *task)
+{
+    int wait_ms = task->interv_ms;
+    if (task->sched_timer || 0 >= task->schedule_ms || NULL == task->on_schedule)
+        return wait_ms;
+    int left = (int)(task->last_scheduled + task->schedule_ms - get_sys_ms());
+    left = NO_LESS_THAN(left, 1);
+    return (QUEUE_WAIT_FOREVER == wait_ms || wait_ms > left) ? left : wait_ms;
+}
+
+/* handle timers expired, return result of the last callback */
+static at_error_t task_on_timers(active_task *task, unsigned int fired)
+{
+    at_error_t ret = INNER_RES_OK;
+    for (int i = 0; i < TASK_TIMER_NUM && 0 != fired; i++, fired >>= 1) {
+        if (0 == (fired & 1)) continue;
+        if (TASK_TIMER_SCHEDULE == i && NULL != task->on_schedule) {
+            KRNL_DEBUG("task %s call on_schedule\n", task->name);
+            task->last_scheduled = get_sys_ms();
+            ret = task->on_schedule(task);
+        } else if (TASK_TIMER_SCHEDULE != i && NULL != task->on_timer) {
+            KRNL_DEBUG("task %s call on_timer %d\n", task->name, i);
+            ret = task->on_timer(task, i);
+        }
+        if (TASK_SVC_BREAK == ret) break;
+    }
+    return ret;
+}
+
+/* hand msg blocks received to callbacks and release them */
+static at_error_t task_dispatch(active_task *task, msgblk **mblks, int num)
+{
+    at_error_t ret = INNER_RES_OK;
+    if (NULL != task->on_message_batch) {
+        // drain up to batch_size per wakeup
+        KRNL_DEBUG("task %s call on_message_batch %d\n", task->name, num);
+        ret = task->on_message_batch(task, mblks, num);
+        for (int i = 0; i < num; i++) msgblk_free(mblks[i]);   // decrease refer
+    } else if (NULL != task->on_message) {
+        // on_message
+        KRNL_DEBUG("task %s call on_message %p\n", task->name, mblks[0]);
+        ret = task->on_message(task, mblks[0]);
+        msgblk_free(mblks[0]);   // decrease refer
+    } else {
+        // drop the message
+        KRNL_DEBUG("task %s drop message %p\n", task->name, mblks[0]);
+        msgblk_free(mblks[0]);   // decrease refer
+    }
+    return ret;
+}
+
+/* number of msg blocks received at once */
+#define task_batch_num(task) (NULL != (task)->on_message_batch \
+    ? NO_MORE_THAN(NO_LESS_THAN((task)->batch_size, 1), TASK_BATCH_MAX) : 1)
+
+/* on_loop, timers and a quota of messages of a pooled task */
+static at_error_t task_step_once(active_task *task)
+{
+    at_error_t ret = INNER_RES_OK;
+    msgblk *mblks[TASK_BATCH_MAX];
+
+    if (TASK_STATE_STOPPING == atomic_load(&task->run_state)) return TASK_SVC_BREAK;
+
+    // on_loop, once per step
+    if (NULL != task->on_loop) {
+        KRNL_DEBUG("task %s call on_loop\n", task->name);
+        ret = task->on_loop(task);
+        if (TASK_SVC_CONTINUE == ret || TASK_SVC_BREAK == ret) return ret;
+    }
+
+    // timers posted by timer wheel
+    unsigned int fired = atomic_exchange(&task->timer_pending, 0);
+    if (0 != fired && TASK_SVC_BREAK == task_on_timers(task, fired))
+        return TASK_SVC_BREAK;
+
+    // messages, at most TASK_STEP_QUOTA batches then yield the worker
+    for (int i = 0; i < TASK_STEP_QUOTA; i++) {
+        int num = task_try_recv(task, mblks, task_batch_num(task));
+        if (0 == num) return INNER_RES_OK;
+        if (TASK_SVC_BREAK == task_dispatch(task, mblks, num)) return TASK_SVC_BREAK;
+    }
+    return TASK_SVC_CONTINUE;
+}
+
+/***
+ * @description : run one step of a pooled active task on executor
+ * @param        {active_task} *task - pointer to active task
+ * @return       {*} - TASK_SVC_CONTINUE if more work, TASK_SVC_BREAK if end
+ */
+static at_error_t dft_task_step(active_task *task)
+{
+    if (NULL == task) return INNER_INVAILD_PARAM;
+    at_error_t ret = task_step_once(task);
+    if (TASK_SVC_BREAK == ret) task_exit(task);
+    return ret;
+}
+
 /***
  * @description : main loop of an active task
  * @param        {active_task} *task - pointer to active task
@@ -105,10 +387,11 @@ static at_error_t dft_task_svc(active_task *task)
     KRNL_DEBUG("task %s running...\n", task->name);
 
     at_error_t ret = -1;
-    msgblk *mblk = NULL;
+    msgblk *mblks[TASK_BATCH_MAX];
+    int num = 0;
     unsigned long now = 0;
 
-    while (true) {
+    while (TASK_STATE_STOPPING != atomic_load(&task->run_state)) {
         // on_loop
         if (NULL != task->on_loop) {
             KRNL_DEBUG("task %s call on_loop\n", task->name);
@@ -117,28 +400,36 @@ static at_error_t dft_task_svc(active_task *task)
             else if (TASK_SVC_BREAK == ret) break;
         }
 
-        // receive message
-        if (NULL != task->queue && INNER_RES_OK == msgblk_pop_circ_queue(
-                task->queue, &mblk, task->interv_ms)) {
-            // on_message
-            if (NULL != task->on_message) {
-                KRNL_DEBUG("task %s call on_message %p\n", task->name, mblk);
-                ret = task->on_message(task, mblk);
-                msgblk_free(mblk);   // decrease refer
-                if (TASK_SVC_CONTINUE == ret) continue;
-                else if (TASK_SVC_BREAK == ret) break;
-            } else {
-                // drop the message
-                KRNL_DEBUG("task %s drop message %p\n", task->name, mblk);
-                msgblk_free(mblk);   // decrease refer
-            }
+        // receive messages, higher priority queue first
+        num = task_batch_num(task);
+        if (NULL != task->queue || NULL != task->queues[TASK_QUEUE_CTRL] \
+            || NULL != task->queues[TASK_QUEUE_BULK] \
+            || task->sched_timer || NULL != task->on_timer) {
+            num = task_recv(task, mblks, num, task_recv_timeout(task));
+        } else {
+            num = 0;
         }
 
-        // on schedule
+        if (0 < num) {
+            ret = task_dispatch(task, mblks, num);
+            if (TASK_SVC_CONTINUE == ret) continue;
+            else if (TASK_SVC_BREAK == ret) break;
+        }
+
+        // timers posted by timer wheel
+        unsigned int fired = atomic_exchange(&task->timer_pending, 0);
+        if (0 != fired) {
+            ret = task_on_timers(task, fired);
+            if (TASK_SVC_CONTINUE == ret) continue;
+            else if (TASK_SVC_BREAK == ret) break;
+        }
+
+        // on schedule, without timer wheel
         now = get_sys_ms();
-        if (0 < task->schedule_ms \
+        if (!task->sched_timer \
+            && 0 < task->schedule_ms \
             && NULL != task->on_schedule \
-            && (now - task->last_scheduled) > task->schedule_ms) {
+            && (long)(now - task->last_scheduled) >= task->schedule_ms) {
                 KRNL_DEBUG("task %s call on_schedule\n", task->name);
                 task->last_scheduled = now;
                 ret = task->on_schedule(task);
@@ -150,6 +441,76 @@ static at_error_t dft_task_svc(active_task *task)
     return INNER_RES_OK;
 }
 
+/* wait for the end of svc thread, or pooled task leaving workers */
+static at_error_t task_join(active_task *task, int timeout_ms)
+{
+    unsigned long deadline = get_sys_ms() + timeout_ms;
+    if (TASK_RUN_POOLED == task->run_mode) {
+        while (TASK_SCHED_DONE != atomic_load(&task->sched_state)) {
+            if (QUEUE_WAIT_FOREVER != timeout_ms && 0 >= (long)(deadline - get_sys_ms()))
+                return OPR_WAIT_TIMEOUT;
+            delay_ms(1);
+        }
+        return INNER_RES_OK;
+    }
+#if defined(__linux__) || defined(__linux)
+    if (QUEUE_WAIT_FOREVER == timeout_ms) {
+        pthread_join(task->task_handler, NULL);
+        return INNER_RES_OK;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    if (0 != pthread_timedjoin_np(task->task_handler, NULL, &ts)) return OPR_WAIT_TIMEOUT;
+#elif defined(CONFIG_FreeRTOS)
+    task->stopper = xTaskGetCurrentTaskHandle();
+    while (!atomic_load(&task->svc_done)) {
+        if (QUEUE_WAIT_FOREVER != timeout_ms && 0 >= (long)(deadline - get_sys_ms()))
+            return OPR_WAIT_TIMEOUT;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+    }
+#endif /* _ESP_PLATFORM */
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : stop an active task, drop pending messages and wait for its end,
+ *                  puts after fail with TASK_NOT_RUNNING, upstream links kept
+ * @param        {active_task} *task - pointer to active task
+ * @param        {int} timeout_ms - wait time in ms, 0 means forever
+ * @return       {*} - OPR_WAIT_TIMEOUT if not ended in time, try again later
+ */
+static at_error_t dft_task_stop(active_task *task, int timeout_ms)
+{
+    if (NULL == task) return INNER_INVAILD_PARAM;
+    int state = TASK_STATE_RUNNING;
+    if (!atomic_compare_exchange_strong(&task->run_state, &state, TASK_STATE_STOPPING)
+        && TASK_STATE_STOPPING != state)
+        return INNER_RES_OK;    // stopped already
+    KRNL_DEBUG("task %s stopping\n", task->name);
+
+    // no more timer events, then wake up svc to see the stop flag
+    task_stop_timers(task);
+    task_wakeup(task);
+    at_error_t res = task_join(task, timeout_ms);
+    if (INNER_RES_OK != res) {
+        KRNL_ERROR("task %s not ended in %d ms\n", task->name, timeout_ms);
+        return res;
+    }
+
+    // messages pushed after svc ended dropped, queues kept till no put in flight
+    task_delete_queues(task);
+    atomic_store(&task->timer_pending, 0);
+    atomic_store(&task->run_state, TASK_STATE_STOPPED);
+    KRNL_DEBUG("task %s stopped\n", task->name);
+    return INNER_RES_OK;
+}
+
 /***
  * @description : put a message block into a queue of an active task
  * @param        {active_task} *task - pointer to active task
@@ -159,10 +520,9 @@ static at_error_t dft_task_svc(active_task *task)
  */
 static at_error_t dft_put_message(active_task *task, msgblk *mblk, int wait_ms)
 {
-    if (NULL == task || NULL == mblk || NULL == task->queue)
-        return INNER_INVAILD_PARAM;
+    if (NULL == task || NULL == mblk) return INNER_INVAILD_PARAM;
     KRNL_DEBUG("task %s put message %p\n", task->name, mblk);
-    return msgblk_push_circ_queue(task->queue, mblk, wait_ms);
+    return task_push(task, TASK_QUEUE_NORMAL, mblk, wait_ms);
 }
 
 /***
@@ -175,10 +535,12 @@ static at_error_t dft_put_message(active_task *task, msgblk *mblk, int wait_ms)
 static at_error_t dft_put_message_next(active_task *task, msgblk *mblk, int wait_ms)
 {
     if (NULL == task || NULL == mblk) return INNER_INVAILD_PARAM;
-    if (NULL == task->next_task || NULL == task->next_task->queue)
-        return TASK_NEXT_NOT_EXIST;
+    if (NULL != atomic_load_explicit(&task->routes, memory_order_relaxed))
+        return active_task_route(task, mblk, wait_ms);
+    active_task *next = task->next_task;
+    if (NULL == next) return TASK_NEXT_NOT_EXIST;
     KRNL_DEBUG("task %s put_next message %p\n", task->name, mblk);
-    return msgblk_push_circ_queue(task->next_task->queue, mblk, wait_ms);
+    return task_push(next, TASK_QUEUE_NORMAL, mblk, wait_ms);
 }
 
 /***
@@ -204,6 +566,7 @@ active_task *active_task_create(const char *name, int t_size, int stack,
         KRNL_ERROR("Failed to malloc for task");
         return NULL;
     }
+    memset(task, 0, t_size);    // callbacks not configured stay NULL
     task->name = strdup(name);
     task->stack_depth = stack;
     task->priority = priority;
@@ -213,25 +576,374 @@ active_task *active_task_create(const char *name, int t_size, int stack,
     task->last_scheduled = 0;
     task->queue = NULL;
     task->queue_length = queue_len;
-    task->next_task = NULL;
+    for (int i = 0; i < TASK_QUEUE_NUM; i++) {
+        task->queues[i] = NULL;
+        task->queue_lengths[i] = 0;
+    }
+    if (INNER_RES_OK != os_event_init(&task->event)) {
+        KRNL_ERROR("Failed to init event for task");
+        free(task->name);
+        free(task);
+        return NULL;
+    }
+    task->queue_flags = QUEUE_F_BLOCK;
+    task->batch_size = TASK_BATCH_MAX;
+    if (INNER_RES_OK != os_mutex_init(&task->route_lock)) {
+        KRNL_ERROR("Failed to init route lock for task");
+        os_event_fini(&task->event);
+        free(task->name);
+        free(task);
+        return NULL;
+    }
+    atomic_init(&task->next_task, NULL);
+    atomic_init(&task->upstream_num, 0);
+    atomic_init(&task->routes, NULL);
+    atomic_init(&task->route_walks, 0);
+    task->routes_retired = NULL;
     task->app_data = app_data;
+    for (int i = 0; i < TASK_TIMER_NUM; i++)
+        at_timer_init(&task->timers[i], task_timer_expire, task);
+    atomic_init(&task->timer_pending, 0);
+    task->sched_timer = false;
+    task->run_mode = TASK_RUN_THREAD;
+    task->pinned = false;
+    atomic_init(&task->run_state, TASK_STATE_STOPPED);
+    atomic_init(&task->puts, 0);
+    atomic_init(&task->svc_done, false);
+    atomic_init(&task->sched_state, TASK_SCHED_IDLE);
 
     active_task_config(task, dft_task_begin, dft_task_svc, dft_put_message,
             dft_put_message_next, NULL, NULL, NULL, NULL);
+    task->task_step = dft_task_step;
+    task->task_stop = dft_task_stop;
     KRNL_DEBUG("task %s created\n", task->name);
     return task;
 }
 
 /***
- * @description : delete an active task
+ * @description : set length of an input queue, call before task_begin
+ * @param        {active_task} *task - pointer to active task
+ * @param        {task_queue_prio} prio - which queue
+ * @param        {size_t} queue_len - length of queue, 0 means no such queue
+ * @return       {*}
+ */
+at_error_t active_task_set_queue(active_task *task, task_queue_prio prio, size_t queue_len)
+{
+    if (NULL == task || TASK_QUEUE_NUM <= (unsigned int)prio) return INNER_INVAILD_PARAM;
+    if (NULL != task->queues[prio]) return TASK_FAILED_QUEUE;  // already running
+    task->queue_lengths[prio] = queue_len;
+    if (TASK_QUEUE_NORMAL == prio) task->queue_length = queue_len;
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : put a message block into an input queue of an active task
+ * @param        {active_task} *task - pointer to active task
+ * @param        {task_queue_prio} prio - which queue
+ * @param        {msgblk} *mblk - pointer to message block
+ * @param        {int} wait_ms - wait time in ms
+ * @return       {*}
+ */
+at_error_t active_task_put_message_prio(active_task *task, task_queue_prio prio,
+        msgblk *mblk, int wait_ms)
+{
+    if (NULL == task || NULL == mblk || TASK_QUEUE_NUM <= (unsigned int)prio)
+        return INNER_INVAILD_PARAM;
+    if (TASK_QUEUE_NORMAL == prio) return task->put_message(task, mblk, wait_ms);
+    KRNL_DEBUG("task %s put message %p to queue %d\n", task->name, mblk, prio);
+    return task_push(task, prio, mblk, wait_ms);
+}
+
+/* route of a task to a downstream task */
+typedef struct {
+    int                       msg_type;     // TASK_ROUTE_ANY for all
+    task_queue_prio               prio;     // input queue of target
+    active_task                *target;
+} task_route;
+
+/**
+ * routes of a task are never changed in place: a writer copies the table under
+ * route_lock and swaps it, so that active_task_route walks without a lock. A
+ * table replaced is retired and freed once no walk is in flight.
+ */
+struct task_route_table_t {
+    task_route_table             *next;     // next retired
+    int                            num;
+    task_route                routes[];
+};
+
+#define ROUTE_ANY_TYPE      (-2)    // match routes to target of any msg_type
+
+/* find a route to target by msg_type in table, -1 if none */
+static int task_find_route(task_route_table *table, int msg_type, active_task *target)
+{
+    for (int i = 0; NULL != table && i < table->num; i++) {
+        task_route *route = &table->routes[i];
+        if (route->target == target && (ROUTE_ANY_TYPE == msg_type || route->msg_type == msg_type))
+            return i;
+    }
+    return -1;
+}
+
+/* task is counted as an upstream of target once, by chain or routes, lock held */
+static bool task_links_to(active_task *task, task_route_table *table, active_task *target)
+{
+    return task->next_task == target || 0 <= task_find_route(table, ROUTE_ANY_TYPE, target);
+}
+
+/* free tables retired if no walk in flight, lock held */
+static void task_free_routes_retired(active_task *task, bool force)
+{
+    if (!force) {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (0 != atomic_load(&task->route_walks)) return;
+    }
+    while (NULL != task->routes_retired) {
+        task_route_table *table = task->routes_retired;
+        task->routes_retired = table->next;
+        free(table);
+    }
+}
+
+/* publish table, NULL if no route, and retire the one replaced, lock held */
+static void task_swap_routes(active_task *task, task_route_table *table)
+{
+    task_route_table *old = atomic_exchange(&task->routes, table);
+    if (NULL != old) {
+        old->next = task->routes_retired;
+        task->routes_retired = old;
+    }
+    task_free_routes_retired(task, false);
+}
+
+/***
+ * @description : add a route to downstream task, used by put_message_next
+ *                  instead of next_task once any route added; a target with
+ *                  more than one upstream gets an MPMC queue to merge them
+ * @param        {active_task} *task - pointer to active task
+ * @param        {int} msg_type - msg type routed, TASK_ROUTE_ANY for all
+ * @param        {active_task} *target - pointer to downstream active task
+ * @param        {task_queue_prio} prio - input queue of target
+ * @return       {*}
+ */
+at_error_t active_task_add_route(active_task *task, int msg_type,
+        active_task *target, task_queue_prio prio)
+{
+    if (NULL == task || NULL == target || TASK_QUEUE_NUM <= (unsigned int)prio)
+        return INNER_INVAILD_PARAM;
+    at_error_t res = INNER_RES_OK;
+    os_mutex_lock(&task->route_lock);
+    task_route_table *old = atomic_load_explicit(&task->routes, memory_order_relaxed);
+    if (0 <= task_find_route(old, msg_type, target)) goto done;
+    bool linked = task_links_to(task, old, target);
+    // a running SPSC queue can't take a second producer
+    if (!linked && NULL != target->queue && (target->queue->flags & QUEUE_F_SPSC)) {
+        res = TASK_QUEUE_EXCLUSIVE;
+        goto done;
+    }
+    int num = NULL == old ? 0 : old->num;
+    task_route_table *table = (task_route_table *)malloc(sizeof(task_route_table)
+            + (num + 1) * sizeof(task_route));
+    if (NULL == table) {
+        res = MEMORY_MALLOC_FAILED;
+        goto done;
+    }
+    if (0 < num) memcpy(table->routes, old->routes, num * sizeof(task_route));
+    table->routes[num].msg_type = msg_type;
+    table->routes[num].prio = prio;
+    table->routes[num].target = target;
+    table->num = num + 1;
+    table->next = NULL;
+    task_swap_routes(task, table);
+    if (!linked) atomic_fetch_add(&target->upstream_num, 1);
+    KRNL_DEBUG("task %s routes %d to %s, upstream %d\n",
+            task->name, msg_type, target->name, atomic_load(&target->upstream_num));
+done:
+    os_mutex_unlock(&task->route_lock);
+    return res;
+}
+
+/***
+ * @description : delete a route to downstream task, safe while task routes,
+ *                  a walk begun before may still put to target once
+ * @param        {active_task} *task - pointer to active task
+ * @param        {int} msg_type - msg type routed, TASK_ROUTE_ANY for all
+ * @param        {active_task} *target - pointer to downstream active task
+ * @return       {*}
+ */
+void active_task_del_route(active_task *task, int msg_type, active_task *target)
+{
+    if (NULL == task || NULL == target) return;
+    os_mutex_lock(&task->route_lock);
+    task_route_table *old = atomic_load_explicit(&task->routes, memory_order_relaxed);
+    int k = task_find_route(old, msg_type, target);
+    if (0 > k) goto done;
+    task_route_table *table = NULL;
+    if (1 < old->num) {
+        table = (task_route_table *)malloc(sizeof(task_route_table)
+                + (old->num - 1) * sizeof(task_route));
+        if (NULL == table) {
+            KRNL_ERROR("task %s failed to delete route to %s\n", task->name, target->name);
+            goto done;
+        }
+        memcpy(table->routes, old->routes, k * sizeof(task_route));
+        memcpy(&table->routes[k], &old->routes[k + 1], (old->num - k - 1) * sizeof(task_route));
+        table->num = old->num - 1;
+        table->next = NULL;
+    }
+    task_swap_routes(task, table);
+    if (!task_links_to(task, table, target)) atomic_fetch_sub(&target->upstream_num, 1);
+done:
+    os_mutex_unlock(&task->route_lock);
+}
+
+/***
+ * @description : check if put_message_next of task has any downstream
+ * @param        {active_task} *task - pointer to active task
+ * @return       {*} - true if next task chained or any route added
+ */
+bool active_task_has_next(active_task *task)
+{
+    return NULL != task && (NULL != task->next_task
+            || NULL != atomic_load_explicit(&task->routes, memory_order_relaxed));
+}
+
+/***
+ * @description : put a message block to all downstream tasks routed by its type,
+ *                  each target takes a reference, no copy
+ * @param        {active_task} *task - pointer to active task
+ * @param        {msgblk} *mblk - pointer to message block
+ * @param        {int} wait_ms - wait time in ms for each target
+ * @return       {*} - error of the last target failed, TASK_NEXT_NOT_EXIST if no route
+ */
+at_error_t active_task_route(active_task *task, msgblk *mblk, int wait_ms)
+{
+    if (NULL == task || NULL == mblk) return INNER_INVAILD_PARAM;
+    at_error_t res = TASK_NEXT_NOT_EXIST;
+    bool delivered = false;
+    // counted before table is read, so a table replaced meanwhile is kept
+    atomic_fetch_add(&task->route_walks, 1);
+    task_route_table *table = atomic_load_explicit(&task->routes, memory_order_acquire);
+    for (int i = 0; NULL != table && i < table->num; i++) {
+        task_route *route = &table->routes[i];
+        if (TASK_ROUTE_ANY != route->msg_type && route->msg_type != mblk->msg_type)
+            continue;
+        at_error_t r = active_task_put_message_prio(route->target, route->prio, mblk, wait_ms);
+        if (INNER_RES_OK != r) {
+            KRNL_ERROR("task %s failed to route %p to %s\n",
+                    task->name, mblk, route->target->name);
+            res = r;
+        } else {
+            delivered = true;
+        }
+    }
+    atomic_fetch_sub_explicit(&task->route_walks, 1, memory_order_release);
+    return delivered && TASK_NEXT_NOT_EXIST == res ? INNER_RES_OK : res;
+}
+
+/***
+ * @description : chain next task after a task, used by put_message_next
+ *                  queue of next task with QUEUE_F_SPSC set takes no other
+ *                  upstream once running
+ * @param        {active_task} *task - pointer to active task
+ * @param        {active_task} *next - pointer to next active task
+ * @return       {*}
+ */
+at_error_t active_task_chain(active_task *task, active_task *next)
+{
+    if (NULL == task || NULL == next) return INNER_INVAILD_PARAM;
+    at_error_t res = INNER_RES_OK;
+    os_mutex_lock(&task->route_lock);
+    task_route_table *table = atomic_load_explicit(&task->routes, memory_order_relaxed);
+    active_task *prev = task->next_task;
+    if (prev == next) goto done;
+    bool linked = task_links_to(task, table, next);
+    // a running SPSC queue can't take a second producer
+    if (!linked && NULL != next->queue && (next->queue->flags & QUEUE_F_SPSC)) {
+        res = TASK_QUEUE_EXCLUSIVE;
+        goto done;
+    }
+    task->next_task = next;
+    if (NULL != prev && !task_links_to(task, table, prev)) atomic_fetch_sub(&prev->upstream_num, 1);
+    if (!linked) atomic_fetch_add(&next->upstream_num, 1);
+    KRNL_DEBUG("task %s chained to %s, upstream %d\n",
+            task->name, next->name, atomic_load(&next->upstream_num));
+done:
+    os_mutex_unlock(&task->route_lock);
+    return res;
+}
+
+/***
+ * @description : start a timer of task, on_timer called in task when expires
+ * @param        {active_task} *task - pointer to active task
+ * @param        {int} timer_id - id of timer, 1 ~ TASK_TIMER_NUM-1
+ * @param        {int} delay_ms - first expiration in ms
+ * @param        {int} period_ms - period in ms, for periodic mode
+ * @param        {at_timer_mode} mode - timer mode
+ * @return       {*}
+ */
+at_error_t active_task_start_timer(active_task *task, int timer_id,
+        int delay_ms, int period_ms, at_timer_mode mode)
+{
+    if (NULL == task || TASK_TIMER_SCHEDULE >= timer_id || TASK_TIMER_NUM <= timer_id)
+        return INNER_INVAILD_PARAM;
+    return timer_wheel_add(&task->timers[timer_id], delay_ms, period_ms, mode);
+}
+
+/***
+ * @description : stop a timer of task
+ * @param        {active_task} *task - pointer to active task
+ * @param        {int} timer_id - id of timer, 1 ~ TASK_TIMER_NUM-1
+ * @return       {*}
+ */
+void active_task_stop_timer(active_task *task, int timer_id)
+{
+    if (NULL == task || TASK_TIMER_SCHEDULE >= timer_id || TASK_TIMER_NUM <= timer_id)
+        return;
+    timer_wheel_del(&task->timers[timer_id]);
+    // drop the expiration not handled yet
+    atomic_fetch_and(&task->timer_pending, ~(1U << timer_id));
+}
+
+/* drop next_task and routes, each downstream counted once in upstream_num */
+static void task_unlink_all(active_task *task)
+{
+    os_mutex_lock(&task->route_lock);
+    task_route_table *table = atomic_exchange(&task->routes, NULL);
+    active_task *next = atomic_exchange(&task->next_task, NULL);
+    if (NULL != next) atomic_fetch_sub(&next->upstream_num, 1);
+    for (int i = 0; NULL != table && i < table->num; i++) {
+        active_task *target = table->routes[i].target;
+        if (target != next && i == task_find_route(table, ROUTE_ANY_TYPE, target))
+            atomic_fetch_sub(&target->upstream_num, 1);
+    }
+    free(table);
+    os_mutex_unlock(&task->route_lock);
+}
+
+/***
+ * @description : delete an active task, stopped and unlinked from its downstream
+ *                  tasks, refused while any upstream still links to it
  * @param        {active_task} *task - pointer to active task
  * @return       {*}
  */
 void active_task_delete(active_task *task)
 {
     if (NULL == task) return;
-    // TODO stop thread
-    if (NULL != task->queue) circ_queue_delete(task->queue);
+    // upstreams would put into freed memory
+    int upstream_num = atomic_load(&task->upstream_num);
+    if (0 < upstream_num) {
+        KRNL_ERROR("task %s linked by %d upstreams, leaked\n", task->name, upstream_num);
+        return;
+    }
+    if (INNER_RES_OK != task->task_stop(task, QUEUE_WAIT_FOREVER)) {
+        KRNL_ERROR("task %s not stopped, leaked\n", task->name);
+        return;
+    }
+    task_unlink_all(task);
+    task_free_routes_retired(task, true);
+    os_mutex_fini(&task->route_lock);
+    os_event_fini(&task->event);
     if (NULL != task->name) free(task->name);
     free(task);
 }
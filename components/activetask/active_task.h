@@ -23,13 +23,72 @@
 #include "inner_err.h"
 #include "circ_queue.h"
 #include "msg_blk.h"
+#include "timer_wheel.h"
+
+#ifndef TASK_BATCH_MAX
+#define TASK_BATCH_MAX      16      // max msg blocks handled per wakeup
+#endif /* TASK_BATCH_MAX */
+
+#ifndef TASK_STEP_QUOTA
+#define TASK_STEP_QUOTA     4       // max batches per step of a pooled task
+#endif /* TASK_STEP_QUOTA */
+
+#define TASK_ROUTE_ANY      (-1)    // route msg blocks of all types
+
+#define TASK_TIMER_NUM      8       // timers per task, bits of timer_pending
+#define TASK_TIMER_SCHEDULE 0       // timer id reserved for on_schedule
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef struct active_task_t active_task;
+typedef struct task_route_table_t task_route_table;
+
+/**
+ * input queues of a task, a lower value is drained first
+ */
+typedef enum {
+    TASK_QUEUE_CTRL,        // commands, never wait behind data
+    TASK_QUEUE_NORMAL,      // default queue, same as task->queue
+    TASK_QUEUE_BULK,        // bulk data e.g. telemetry
+    TASK_QUEUE_NUM
+} task_queue_prio;
 
+/**
+ * how an active task runs, set before task_begin
+ */
+typedef enum {
+    TASK_RUN_THREAD,        // own FreeRTOS task / pthread, blocking in task_svc
+    TASK_RUN_POOLED,        // state machine run by task_step on executor workers
+} task_run_mode;
+
+/**
+ * lifecycle of an active task
+ */
+typedef enum {
+    TASK_STATE_STOPPED,     // created, or stopped, task_begin allowed
+    TASK_STATE_STARTING,    // task_begin creating queues, puts refused
+    TASK_STATE_RUNNING,     // begun, puts taken
+    TASK_STATE_STOPPING,    // task_stop waiting for svc to end
+} task_run_state;
+
+/**
+ * scheduling state of a pooled task
+ */
+typedef enum {
+    TASK_SCHED_IDLE,        // nothing to do
+    TASK_SCHED_QUEUED,      // in run queue of executor
+    TASK_SCHED_RUNNING,     // running on a worker
+    TASK_SCHED_DIRTY,       // running, and kicked again meanwhile
+    TASK_SCHED_DONE,        // task_step returned TASK_SVC_BREAK
+} task_sched_state;
+
+/**
+ * QUEUE_F_SPSC in queue_flags is an opt-in for the NORMAL queue only: set it
+ * only if the single chained or routed upstream task is the one producer,
+ * no put_message from other threads, callbacks or blackboard notices.
+ */
 struct active_task_t {
     char                         *name;
     int                    stack_depth;     // stack depth of freeRTOS task
@@ -44,11 +103,32 @@ struct active_task_t {
     int                    schedule_ms;
     int                 last_scheduled;
 
-    circ_queue                  *queue;
+    circ_queue                  *queue;     // TASK_QUEUE_NORMAL
     int                   queue_length;
-    active_task             *next_task;     // next task in streamly processing
+    circ_queue *queues[TASK_QUEUE_NUM];     // input queues by priority
+    int   queue_lengths[TASK_QUEUE_NUM];
+    os_event                     event;     // wakeup when any queue pushed
+    int                    queue_flags;     // QUEUE_F_xxx for creating queue
+    int                     batch_size;     // max msg for on_message_batch
+    _Atomic(active_task *)   next_task;     // next task in streamly processing
+    atomic_int            upstream_num;     // tasks chained or routed to this one
+    _Atomic(task_route_table *) routes;     // routes to downstream tasks, copied on write
+    atomic_uint            route_walks;     // walks of routes in flight
+    task_route_table   *routes_retired;     // replaced, freed once no walk in flight
+    os_mutex                route_lock;     // held by writers of routes and next_task
     void                     *app_data;     // reserved for app
-
+    at_timer timers[TASK_TIMER_NUM];        // timers on timer wheel
+    atomic_uint          timer_pending;     // bits of timers expired
+    bool                   sched_timer;     // on_schedule driven by timer wheel
+    task_run_mode             run_mode;
+    bool                        pinned;     // pooled task runs on worker core_id only
+    atomic_int             sched_state;     // task_sched_state, pooled only
+    atomic_int               run_state;     // task_run_state
+    atomic_uint                   puts;     // puts in flight, queues kept till none
+    atomic_bool               svc_done;     // svc thread ended
+#if defined(CONFIG_FreeRTOS)
+    TaskHandle_t               stopper;     // task waiting in task_stop
+#endif /* _ESP_PLATFORM */
 
     /***
      * @description : start running of an active task
@@ -64,6 +144,22 @@ struct active_task_t {
      */
     at_error_t (*task_svc)(active_task *task);
 
+    /***
+     * @description : run one step of a pooled active task on executor
+     * @param        {active_task} *task - pointer to active task
+     * @return       {*} - TASK_SVC_CONTINUE if more work, TASK_SVC_BREAK if end
+     */
+    at_error_t (*task_step)(active_task *task);
+
+    /***
+     * @description : stop an active task, drop pending messages and wait for its end,
+     *                  puts after fail with TASK_NOT_RUNNING, upstream links kept
+     * @param        {active_task} *task - pointer to active task
+     * @param        {int} timeout_ms - wait time in ms, 0 means forever
+     * @return       {*} - OPR_WAIT_TIMEOUT if not ended in time, try again later
+     */
+    at_error_t (*task_stop)(active_task *task, int timeout_ms);
+
     /***
      * @description : put a message block into a queue of an active task
      * @param        {active_task} *task - pointer to active task
@@ -89,6 +185,13 @@ struct active_task_t {
      */
     at_error_t (*on_init)(active_task *task);
 
+    /***
+     * @description : callback when an Acitve Task ends, in its own context
+     * @param        {active_task} *task - pointer to active task
+     * @return       {*}
+     */
+    at_error_t (*on_fini)(active_task *task);
+
     /***
      * @description : callback when an Acitve Task running
      * @param        {active_task} *task - pointer to active task
@@ -104,12 +207,30 @@ struct active_task_t {
      */
     at_error_t (*on_message)(active_task *task, msgblk *mblk);
 
+    /***
+     * @description : callback when message blocks got from the queue in batch,
+     *                  used instead of on_message if set
+     * @param        {active_task} *task - pointer to active task
+     * @param        {msgblk} **mblks - array of message blocks
+     * @param        {int} num - number of message blocks, up to batch_size
+     * @return       {*}
+     */
+    at_error_t (*on_message_batch)(active_task *task, msgblk **mblks, int num);
+
     /***
      * @description : callback when scheduled timeout occurs
      * @param        {active_task} *task - pointer to active task
      * @return       {*}
      */
     at_error_t (*on_schedule)(active_task *task);
+
+    /***
+     * @description : callback when a timer of task expires, in task context
+     * @param        {active_task} *task - pointer to active task
+     * @param        {int} timer_id - id of timer, 1 ~ TASK_TIMER_NUM-1
+     * @return       {*}
+     */
+    at_error_t (*on_timer)(active_task *task, int timer_id);
 };
 
 #define SIZE_ACTIVE_TASK    sizeof(struct active_task_t)
@@ -132,7 +253,8 @@ active_task *active_task_create(const char *name, int t_size, int stack,
         int schedule, void *app_data);
 
 /***
- * @description : delete an active task
+ * @description : delete an active task, stopped and unlinked from its downstream
+ *                  tasks, refused while any upstream still links to it
  * @param        {active_task} *task - pointer to active task
  * @return       {*}
  */
@@ -151,6 +273,96 @@ do { \
     if (NULL != sch) task->on_schedule = sch; \
 } while (0)
 
+/***
+ * @description : set length of an input queue, call before task_begin
+ * @param        {active_task} *task - pointer to active task
+ * @param        {task_queue_prio} prio - which queue
+ * @param        {size_t} queue_len - length of queue, 0 means no such queue
+ * @return       {*}
+ */
+at_error_t active_task_set_queue(active_task *task, task_queue_prio prio, size_t queue_len);
+
+/***
+ * @description : put a message block into an input queue of an active task
+ * @param        {active_task} *task - pointer to active task
+ * @param        {task_queue_prio} prio - which queue
+ * @param        {msgblk} *mblk - pointer to message block
+ * @param        {int} wait_ms - wait time in ms
+ * @return       {*}
+ */
+at_error_t active_task_put_message_prio(active_task *task, task_queue_prio prio,
+        msgblk *mblk, int wait_ms);
+
+/***
+ * @description : chain next task after a task, used by put_message_next
+ *                  queue of next task with QUEUE_F_SPSC set takes no other
+ *                  upstream once running
+ * @param        {active_task} *task - pointer to active task
+ * @param        {active_task} *next - pointer to next active task
+ * @return       {*}
+ */
+at_error_t active_task_chain(active_task *task, active_task *next);
+
+/***
+ * @description : add a route to downstream task, used by put_message_next
+ *                  instead of next_task once any route added; a target with
+ *                  more than one upstream gets an MPMC queue to merge them
+ * @param        {active_task} *task - pointer to active task
+ * @param        {int} msg_type - msg type routed, TASK_ROUTE_ANY for all
+ * @param        {active_task} *target - pointer to downstream active task
+ * @param        {task_queue_prio} prio - input queue of target
+ * @return       {*}
+ */
+at_error_t active_task_add_route(active_task *task, int msg_type,
+        active_task *target, task_queue_prio prio);
+
+/***
+ * @description : delete a route to downstream task, safe while task routes,
+ *                  a walk begun before may still put to target once
+ * @param        {active_task} *task - pointer to active task
+ * @param        {int} msg_type - msg type routed, TASK_ROUTE_ANY for all
+ * @param        {active_task} *target - pointer to downstream active task
+ * @return       {*}
+ */
+void active_task_del_route(active_task *task, int msg_type, active_task *target);
+
+/***
+ * @description : check if put_message_next of task has any downstream
+ * @param        {active_task} *task - pointer to active task
+ * @return       {*} - true if next task chained or any route added
+ */
+bool active_task_has_next(active_task *task);
+
+/***
+ * @description : put a message block to all downstream tasks routed by its type,
+ *                  each target takes a reference, no copy
+ * @param        {active_task} *task - pointer to active task
+ * @param        {msgblk} *mblk - pointer to message block
+ * @param        {int} wait_ms - wait time in ms for each target
+ * @return       {*} - error of the last target failed, TASK_NEXT_NOT_EXIST if no route
+ */
+at_error_t active_task_route(active_task *task, msgblk *mblk, int wait_ms);
+
+/***
+ * @description : start a timer of task, on_timer called in task when expires
+ * @param        {active_task} *task - pointer to active task
+ * @param        {int} timer_id - id of timer, 1 ~ TASK_TIMER_NUM-1
+ * @param        {int} delay_ms - first expiration in ms
+ * @param        {int} period_ms - period in ms, for periodic mode
+ * @param        {at_timer_mode} mode - timer mode
+ * @return       {*}
+ */
+at_error_t active_task_start_timer(active_task *task, int timer_id,
+        int delay_ms, int period_ms, at_timer_mode mode);
+
+/***
+ * @description : stop a timer of task
+ * @param        {active_task} *task - pointer to active task
+ * @param        {int} timer_id - id of timer, 1 ~ TASK_TIMER_NUM-1
+ * @return       {*}
+ */
+void active_task_stop_timer(active_task *task, int timer_id);
+
 /***
  * @description : start running of an active task
  * @param        {active_task} *task - pointer to active task
@@ -0,0 +1,99 @@
+/***
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 18:05:31
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 18:05:31
+ * @FilePath    : /activetask/components/activetask/blk_magazine.h
+ * @Description : per-thread magazine of free blocks in front of a pool stack
+ * @Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#ifndef _BLK_MAGAZINE_H_
+#define _BLK_MAGAZINE_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "linux_macros.h"
+#include "linux_llist.h"
+#include "lf_stack.h"
+
+#ifndef BLK_MAG_SIZE
+#ifdef CONFIG_BLK_MAG_SIZE
+#define BLK_MAG_SIZE        CONFIG_BLK_MAG_SIZE
+#else
+#define BLK_MAG_SIZE        8       // max free blocks cached per thread and class, 0 for none
+#endif /* CONFIG_BLK_MAG_SIZE */
+#endif /* BLK_MAG_SIZE */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A magazine is owned by one thread and never touched by others, so alloc and
+ * free on it need no atomics. Only refill and flush go to the shared depot,
+ * half a magazine at a time.
+ *
+ * cap is decided per pool class from the most blocks the class may ever hold,
+ * not the blocks preallocated: a magazine keeps no more than a quarter of them
+ * so free blocks stranded in the magazine of another thread can't drain a class.
+ */
+typedef struct {
+    int                          count;
+    struct llist_node *nodes[NO_LESS_THAN(BLK_MAG_SIZE, 1)];   // unused if size 0
+} blk_magazine;
+
+/* magazine capacity for a pool class of max_num blocks at most, 0 for depot only */
+#define blk_mag_cap(max_num) \
+    ((max_num) / 4 < 2 ? 0 : NO_MORE_THAN((max_num) / 4, BLK_MAG_SIZE))
+
+/* get a free block, refill from depot when empty */
+static inline struct llist_node *blk_mag_alloc(blk_magazine *mag, int cap,
+        lf_stack *depot)
+{
+    if (0 < mag->count) return mag->nodes[--mag->count];
+    if (0 == cap) return lf_stack_pop(depot);
+    struct llist_node *node;
+    for (int n = (cap + 1) / 2; 0 < n && NULL != (node = lf_stack_pop(depot)); n--)
+        mag->nodes[mag->count++] = node;
+    return 0 < mag->count ? mag->nodes[--mag->count] : NULL;
+}
+
+/* put a free block back, flush half to depot in one batch when full */
+static inline void blk_mag_free(blk_magazine *mag, int cap, struct llist_node *node,
+        lf_stack *depot)
+{
+    if (mag->count < cap) {
+        mag->nodes[mag->count++] = node;
+        return;
+    }
+    // link node with the upper half of magazine
+    int keep = cap / 2;
+    struct llist_node *first = node;
+    for (int i = keep; i < mag->count; i++) {
+        mag->nodes[i]->next = first;
+        first = mag->nodes[i];
+    }
+    mag->count = keep;
+    lf_stack_push_batch(depot, first, node);
+}
+
+/* return all cached blocks to depot, e.g. before the thread ends */
+static inline void blk_mag_flush(blk_magazine *mag, lf_stack *depot)
+{
+    if (0 == mag->count) return;
+    struct llist_node *last = mag->nodes[0];
+    struct llist_node *first = last;
+    for (int i = 1; i < mag->count; i++) {
+        mag->nodes[i]->next = first;
+        first = mag->nodes[i];
+    }
+    mag->count = 0;
+    lf_stack_push_batch(depot, first, last);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLK_MAGAZINE_H_ */
@@ -0,0 +1,157 @@
+/***
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 21:36:10
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 21:36:10
+ * @FilePath    : /activetask/components/activetask/blk_stats.h
+ * @Description : usage counters of block pools
+ * @Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#ifndef _BLK_STATS_H_
+#define _BLK_STATS_H_
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include "linux_macros.h"
+
+#ifndef BLK_STATS_FOLD
+#ifdef CONFIG_BLK_STATS_FOLD
+#define BLK_STATS_FOLD      CONFIG_BLK_STATS_FOLD
+#else
+#define BLK_STATS_FOLD      32      // ops of a thread folded into shared counters at once
+#endif /* CONFIG_BLK_STATS_FOLD */
+#endif /* BLK_STATS_FOLD */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Counters of a pool or a size class, updated with relaxed atomics on the
+ * alloc and free path. Hold time is a moving average of 1/16 weight, updates
+ * racing with each other may lose one sample which is fine for sizing pools.
+ */
+typedef struct {
+    atomic_int                    used;     // blocks in use
+    atomic_int                    peak;     // max blocks in use
+    atomic_uint                  fails;     // alloc got NULL
+    atomic_uint              fallbacks;     // alloc served by other class or heap
+    atomic_uint            hold_ms_x16;     // average hold time, 16 times
+    atomic_long                  bytes;     // bytes requested by blocks in use
+} blk_counter;
+
+/**
+ * Deltas of a blk_counter kept by one thread without atomics, folded into the
+ * shared counter every BLK_STATS_FOLD allocs and frees, and when the thread
+ * flushes its magazines. Readers see each thread up to BLK_STATS_FOLD ops
+ * late, and peak is estimated from the highest delta between folds.
+ */
+typedef struct {
+    int                           used;     // allocs minus frees
+    int                           high;     // max of used since last fold
+    int                            ops;     // allocs and frees since last fold
+    unsigned int                 freed;     // frees since last fold
+    unsigned long              hold_ms;     // hold time of those frees
+    long                         bytes;     // bytes of allocs minus frees
+} blk_counter_local;
+
+/*
+ * snapshot of a pool or a size class
+ */
+typedef struct {
+    int                       capacity;     // block capacity, 0 if various
+    int                        blk_num;     // blocks of pool, in use if not pooled
+    int                       used_num;     // blocks in use
+    int                       peak_num;     // max blocks in use
+    unsigned int              fail_num;     // alloc got NULL
+    unsigned int          fallback_num;     // alloc served by other class or heap
+    unsigned int           avg_hold_ms;     // average time from alloc to free
+    long                    used_bytes;     // bytes requested by blocks in use
+    long                  wasted_bytes;     // capacity in use but not requested
+} blk_stats;
+
+static inline void blk_counter_alloc(blk_counter *cnt)
+{
+    int used = atomic_fetch_add_explicit(&cnt->used, 1, memory_order_relaxed) + 1;
+    int peak = atomic_load_explicit(&cnt->peak, memory_order_relaxed);
+    while (used > peak && !atomic_compare_exchange_weak_explicit(&cnt->peak, &peak, used,
+            memory_order_relaxed, memory_order_relaxed));
+}
+
+static inline void blk_counter_free(blk_counter *cnt, unsigned long hold_ms)
+{
+    atomic_fetch_sub_explicit(&cnt->used, 1, memory_order_relaxed);
+    unsigned int avg = atomic_load_explicit(&cnt->hold_ms_x16, memory_order_relaxed);
+    avg = avg - avg / 16 + (unsigned int)hold_ms;
+    atomic_store_explicit(&cnt->hold_ms_x16, avg, memory_order_relaxed);
+}
+
+/* add deltas of a thread to shared counter and reset them */
+static inline void blk_counter_fold(blk_counter *cnt, blk_counter_local *loc)
+{
+    if (0 != loc->used || 0 < loc->high) {
+        int used = atomic_fetch_add_explicit(&cnt->used, loc->used, memory_order_relaxed)
+                + loc->high;
+        int peak = atomic_load_explicit(&cnt->peak, memory_order_relaxed);
+        while (used > peak && !atomic_compare_exchange_weak_explicit(&cnt->peak, &peak, used,
+                memory_order_relaxed, memory_order_relaxed));
+    }
+    if (0 != loc->bytes)
+        atomic_fetch_add_explicit(&cnt->bytes, loc->bytes, memory_order_relaxed);
+    if (0 < loc->freed) {
+        // apply the mean of frees as samples, older than 64 samples weigh nothing
+        unsigned int mean = (unsigned int)(loc->hold_ms / loc->freed);
+        unsigned int avg = atomic_load_explicit(&cnt->hold_ms_x16, memory_order_relaxed);
+        for (unsigned int i = 0; i < loc->freed && i < 64; i++) avg = avg - avg / 16 + mean;
+        atomic_store_explicit(&cnt->hold_ms_x16, avg, memory_order_relaxed);
+    }
+    memset(loc, 0, sizeof(blk_counter_local));
+}
+
+/* count an alloc of bytes by current thread */
+static inline void blk_counter_local_alloc(blk_counter *cnt, blk_counter_local *loc, long bytes)
+{
+    if (++loc->used > loc->high) loc->high = loc->used;
+    loc->bytes += bytes;
+    if (BLK_STATS_FOLD <= ++loc->ops) blk_counter_fold(cnt, loc);
+}
+
+/* count a free of bytes by current thread */
+static inline void blk_counter_local_free(blk_counter *cnt, blk_counter_local *loc,
+        long bytes, unsigned long hold_ms)
+{
+    loc->used--;
+    loc->bytes -= bytes;
+    loc->freed++;
+    loc->hold_ms += hold_ms;
+    if (BLK_STATS_FOLD <= ++loc->ops) blk_counter_fold(cnt, loc);
+}
+
+static inline void blk_counter_fail(blk_counter *cnt)
+{
+    atomic_fetch_add_explicit(&cnt->fails, 1, memory_order_relaxed);
+}
+
+static inline void blk_counter_fallback(blk_counter *cnt)
+{
+    atomic_fetch_add_explicit(&cnt->fallbacks, 1, memory_order_relaxed);
+}
+
+/* fill counters part of a snapshot */
+static inline void blk_counter_read(blk_counter *cnt, blk_stats *stats)
+{
+    // deltas folded by threads in different order may dip below zero for a while
+    stats->used_num = NO_LESS_THAN(atomic_load_explicit(&cnt->used, memory_order_relaxed), 0);
+    stats->peak_num = atomic_load_explicit(&cnt->peak, memory_order_relaxed);
+    stats->fail_num = atomic_load_explicit(&cnt->fails, memory_order_relaxed);
+    stats->fallback_num = atomic_load_explicit(&cnt->fallbacks, memory_order_relaxed);
+    stats->avg_hold_ms = atomic_load_explicit(&cnt->hold_ms_x16, memory_order_relaxed) / 16;
+    stats->used_bytes = NO_LESS_THAN(atomic_load_explicit(&cnt->bytes, memory_order_relaxed), 0L);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLK_STATS_H_ */
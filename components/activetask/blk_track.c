@@ -0,0 +1,135 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 22:10:45
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 22:10:45
+ * @FilePath    : /activetask/components/activetask/blk_track.c
+ * @Description :
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "linux_macros.h"
+#include "os_sync.h"
+#include "blk_track.h"
+
+#ifdef BLK_TRACK
+
+typedef struct {
+    os_mutex                      lock;
+    struct list_head              live;     // blocks in use, oldest first
+    bool                        inited;
+} blk_tracker;
+
+static blk_tracker g_blk_tracker;
+
+static __thread const char *t_owner = NULL;     // task running on this thread
+
+/***
+ * @description : init list of live blocks, called by pools, only once done
+ * @return       {*}
+ */
+at_error_t blk_track_init(void)
+{
+    if (g_blk_tracker.inited) return INNER_RES_OK;
+    if (INNER_RES_OK != os_mutex_init(&g_blk_tracker.lock)) return MEMORY_MALLOC_FAILED;
+    INIT_LIST_HEAD(&g_blk_tracker.live);
+    g_blk_tracker.inited = true;
+    KRNL_INFO("block tracking on\n");
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : set task name owning blocks malloced by current thread,
+ *                  called when a task starts running on a thread
+ * @param        {char} *name - task name, kept as pointer
+ * @return       {*}
+ */
+void blk_track_set_owner(const char *name)
+{
+    t_owner = name;
+}
+
+/***
+ * @description : get task name owning blocks malloced by current thread
+ * @return       {*}
+ */
+const char *blk_track_get_owner(void)
+{
+    if (NULL != t_owner) return t_owner;
+#if defined(__linux__) || defined(__linux)
+    return "thread";
+#elif defined(CONFIG_FreeRTOS)
+    return pcTaskGetName(NULL);
+#endif /* _ESP_PLATFORM */
+}
+
+/***
+ * @description : add a block malloced to list of live blocks
+ * @param        {blk_track} *trk - record in block
+ * @param        {char} *kind - type of block
+ * @param        {void} *blk - block given to user
+ * @param        {void} *site - caller of malloc
+ * @return       {*}
+ */
+void blk_track_add(blk_track *trk, const char *kind, const void *blk, const void *site)
+{
+    trk->kind = kind;
+    trk->blk = blk;
+    trk->site = site;
+    trk->owner = blk_track_get_owner();
+    trk->alloc_ms = get_sys_ms();
+    os_mutex_lock(&g_blk_tracker.lock);
+    list_add_tail(&trk->node, &g_blk_tracker.live);
+    os_mutex_unlock(&g_blk_tracker.lock);
+}
+
+/***
+ * @description : remove a block released from list of live blocks
+ * @param        {blk_track} *trk - record in block
+ * @return       {*}
+ */
+void blk_track_del(blk_track *trk)
+{
+    os_mutex_lock(&g_blk_tracker.lock);
+    list_del_init(&trk->node);
+    os_mutex_unlock(&g_blk_tracker.lock);
+}
+
+/***
+ * @description : report free of a block not in use
+ * @param        {blk_track} *trk - record in block, of its last malloc
+ * @param        {void} *blk - block freed
+ * @param        {void} *site - caller of free
+ * @return       {*}
+ */
+void blk_track_double_free(blk_track *trk, const void *blk, const void *site)
+{
+    KRNL_ERROR("double free of %s %p at %p by %s, last malloc at %p by %s\n",
+            trk->kind, blk, site, blk_track_get_owner(), trk->site, trk->owner);
+}
+
+/***
+ * @description : log blocks in use for longer than age_ms
+ * @param        {int} age_ms - min age of blocks logged
+ * @return       {*} - number of blocks logged
+ */
+int blk_track_dump(int age_ms)
+{
+    int num = 0;
+    unsigned long now = get_sys_ms();
+    blk_track *trk;
+    os_mutex_lock(&g_blk_tracker.lock);
+    list_for_each_entry(trk, &g_blk_tracker.live, node) {
+        unsigned long age = now - trk->alloc_ms;
+        if ((unsigned long)age_ms > age) break;     // the rest are younger
+        KRNL_WARN("%s %p alive %lu ms, malloc at %p by %s\n",
+                trk->kind, trk->blk, age, trk->site, trk->owner);
+        num++;
+    }
+    os_mutex_unlock(&g_blk_tracker.lock);
+    return num;
+}
+
+#endif /* BLK_TRACK */
@@ -0,0 +1,124 @@
+/***
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 22:10:45
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 22:10:45
+ * @FilePath    : /activetask/components/activetask/blk_track.h
+ * @Description : tracking of live blocks, for leak and double free detection
+ * @Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#ifndef _BLK_TRACK_H_
+#define _BLK_TRACK_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "inner_err.h"
+#include "linux_list.h"
+
+#if defined(CONFIG_BLK_TRACK) && !defined(BLK_TRACK)
+#define BLK_TRACK
+#endif /* CONFIG_BLK_TRACK */
+
+#ifndef BLK_TRACK_AGE_MS
+#ifdef CONFIG_BLK_TRACK_AGE_MS
+#define BLK_TRACK_AGE_MS    CONFIG_BLK_TRACK_AGE_MS
+#else
+#define BLK_TRACK_AGE_MS    10000
+#endif /* CONFIG_BLK_TRACK_AGE_MS */
+#endif /* BLK_TRACK_AGE_MS */
+
+/* code address calling malloc, resolve with addr2line */
+#define BLK_CALLER()    __builtin_return_address(0)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * With BLK_TRACK defined, each msg and data block in use carries a record of
+ * where and by which task it was malloced, linked in a list of live blocks.
+ * Adding and removing take a mutex, no more than one list operation each, so
+ * the mode can stay on for soak tests. Without BLK_TRACK all calls are empty.
+ */
+typedef struct {
+    struct list_head              node;     // in list of live blocks
+    const char                   *kind;     // type of block
+    const void                    *blk;     // block given to user
+    const void                   *site;     // caller of malloc
+    const char                  *owner;     // task of malloc caller
+    unsigned long             alloc_ms;     // time of malloc
+} blk_track;
+
+#ifdef BLK_TRACK
+
+/***
+ * @description : init list of live blocks, called by pools, only once done
+ * @return       {*}
+ */
+at_error_t blk_track_init(void);
+
+/***
+ * @description : set task name owning blocks malloced by current thread,
+ *                  called when a task starts running on a thread
+ * @param        {char} *name - task name, kept as pointer
+ * @return       {*}
+ */
+void blk_track_set_owner(const char *name);
+
+/***
+ * @description : get task name owning blocks malloced by current thread
+ * @return       {*}
+ */
+const char *blk_track_get_owner(void);
+
+/***
+ * @description : add a block malloced to list of live blocks
+ * @param        {blk_track} *trk - record in block
+ * @param        {char} *kind - type of block
+ * @param        {void} *blk - block given to user
+ * @param        {void} *site - caller of malloc
+ * @return       {*}
+ */
+void blk_track_add(blk_track *trk, const char *kind, const void *blk, const void *site);
+
+/***
+ * @description : remove a block released from list of live blocks
+ * @param        {blk_track} *trk - record in block
+ * @return       {*}
+ */
+void blk_track_del(blk_track *trk);
+
+/***
+ * @description : report free of a block not in use
+ * @param        {blk_track} *trk - record in block, of its last malloc
+ * @param        {void} *blk - block freed
+ * @param        {void} *site - caller of free
+ * @return       {*}
+ */
+void blk_track_double_free(blk_track *trk, const void *blk, const void *site);
+
+/***
+ * @description : log blocks in use for longer than age_ms
+ * @param        {int} age_ms - min age of blocks logged
+ * @return       {*} - number of blocks logged
+ */
+int blk_track_dump(int age_ms);
+
+#else
+
+#define blk_track_init()                        INNER_RES_OK
+#define blk_track_set_owner(name)               ((void)(name))
+static inline const char *blk_track_get_owner(void) { return NULL; }
+#define blk_track_add(trk, kind, blk, site)     do {} while (0)
+#define blk_track_del(trk)                      do {} while (0)
+#define blk_track_double_free(trk, blk, site)   do {} while (0)
+static inline int blk_track_dump(int age_ms) { return 0; }
+
+#endif /* BLK_TRACK */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLK_TRACK_H_ */
@@ -9,71 +9,273 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "linux_macros.h"
 #include "circ_queue.h"
 
-static at_error_t dft_queue_push(circ_queue *pqueue, void *arg, int wait_ms)
+/* ms for wait deadlines, monotonic so that a wall clock step can't cut or stretch a wait */
+#if defined(__linux__) || defined(__linux)
+static unsigned long queue_now_ms(void)
 {
-    if (NULL == pqueue || NULL == arg) return INNER_INVAILD_PARAM;
-    int index = -1;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+#elif defined(CONFIG_FreeRTOS)
+#define queue_now_ms()  get_sys_ms()    // tick count, monotonic already
+#endif /* _ESP_PLATFORM */
+
+/* try to move up to num pointers in one reservation, return number moved */
+typedef int (*ring_opr)(circ_queue *pqueue, void **args, int num);
+
+static int ring_try_push(circ_queue *pqueue, void **args, int num)
+{
+    int n = 0;
+    unsigned int pos = atomic_load_explicit(&pqueue->tail, memory_order_relaxed);
+    for (;;) {
+        // count free slots from pos, they stay free until tail passes them
+        int diff = 0;
+        for (n = 0; n < num; n++) {
+            unsigned int seq = atomic_load_explicit(
+                    &pqueue->slots[(pos + n) & pqueue->mask].seq, memory_order_acquire);
+            if (0 != (diff = (int)(seq - (pos + n)))) break;
+        }
+        if (0 < n) {
+            // own the whole range with one CAS
+            if (atomic_compare_exchange_weak_explicit(&pqueue->tail, &pos, pos + n,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (0 > diff) {
+            return 0;   // full, slot still hold by previous lap
+        } else {
+            pos = atomic_load_explicit(&pqueue->tail, memory_order_relaxed);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        struct circ_slot *slot = &pqueue->slots[(pos + i) & pqueue->mask];
+        slot->data = args[i];
+        atomic_store_explicit(&slot->seq, pos + i + 1, memory_order_release);
+    }
+    KRNL_DEBUG("push queue %p pos %u with %d\n", pqueue, pos & pqueue->mask, n);
+    return n;
+}
+
+static int ring_try_pop(circ_queue *pqueue, void **args, int num)
+{
+    int n = 0;
+    unsigned int pos = atomic_load_explicit(&pqueue->head, memory_order_relaxed);
+    for (;;) {
+        // count filled slots from pos, they stay filled until head passes them
+        int diff = 0;
+        for (n = 0; n < num; n++) {
+            unsigned int seq = atomic_load_explicit(
+                    &pqueue->slots[(pos + n) & pqueue->mask].seq, memory_order_acquire);
+            if (0 != (diff = (int)(seq - (pos + n + 1)))) break;
+        }
+        if (0 < n) {
+            // own the whole range with one CAS
+            if (atomic_compare_exchange_weak_explicit(&pqueue->head, &pos, pos + n,
+                    memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (0 > diff) {
+            return 0;   // empty, or producer not finished writing
+        } else {
+            pos = atomic_load_explicit(&pqueue->head, memory_order_relaxed);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        struct circ_slot *slot = &pqueue->slots[(pos + i) & pqueue->mask];
+        args[i] = slot->data;
+        // release slot to the producer of next lap
+        atomic_store_explicit(&slot->seq, pos + i + pqueue->mask + 1, memory_order_release);
+    }
+    KRNL_DEBUG("pop queue %p pos %u with %d\n", pqueue, pos & pqueue->mask, n);
+    return n;
+}
+
+static int spsc_try_push(circ_queue *pqueue, void **args, int num)
+{
+    unsigned int pos = atomic_load_explicit(&pqueue->tail, memory_order_relaxed);
+    unsigned int space = pqueue->mask + 1 - (pos - pqueue->cached_head);
+    if (space < (unsigned int)num) {
+        // looks full, refresh the view of consumer
+        pqueue->cached_head = atomic_load_explicit(&pqueue->head, memory_order_acquire);
+        space = pqueue->mask + 1 - (pos - pqueue->cached_head);
+    }
+    int n = NO_MORE_THAN(num, (int)space);
+    for (int i = 0; i < n; i++) pqueue->slots[(pos + i) & pqueue->mask].data = args[i];
+    if (0 < n) atomic_store_explicit(&pqueue->tail, pos + n, memory_order_release);
+    KRNL_DEBUG("push spsc queue %p pos %u with %d\n", pqueue, pos & pqueue->mask, n);
+    return n;
+}
+
+static int spsc_try_pop(circ_queue *pqueue, void **args, int num)
+{
+    unsigned int pos = atomic_load_explicit(&pqueue->head, memory_order_relaxed);
+    unsigned int count = pqueue->cached_tail - pos;
+    if (count < (unsigned int)num) {
+        // looks empty, refresh the view of producer
+        pqueue->cached_tail = atomic_load_explicit(&pqueue->tail, memory_order_acquire);
+        count = pqueue->cached_tail - pos;
+    }
+    int n = NO_MORE_THAN(num, (int)count);
+    for (int i = 0; i < n; i++) args[i] = pqueue->slots[(pos + i) & pqueue->mask].data;
+    if (0 < n) atomic_store_explicit(&pqueue->head, pos + n, memory_order_release);
+    KRNL_DEBUG("pop spsc queue %p pos %u with %d\n", pqueue, pos & pqueue->mask, n);
+    return n;
+}
+
+/* retry every QUEUE_INTV_MS, kept for comparison with blocking mode */
+static int queue_wait_poll(circ_queue *pqueue, ring_opr opr, void **args,
+        int num, int wait_ms)
+{
+    int done = 0;
     for (int i = QUEUE_INTV_MS;
-        (0 == wait_ms || i < wait_ms) && -1 == (index = CIRC_WRITE_ONE(&(pqueue->_circ_buf)));
+        (QUEUE_WAIT_FOREVER == wait_ms || i < wait_ms) && 0 == (done = opr(pqueue, args, num));
         i+=QUEUE_INTV_MS)
     {
         delay_ms(QUEUE_INTV_MS);
     }
-    if (-1 == index) return OPR_WAIT_TIMEOUT;
+    return done;
+}
+
+/* sleep on the event until the peer notifies or wait_ms elapsed */
+static int queue_wait_block(circ_queue *pqueue, os_event *ev, ring_opr opr,
+        void **args, int num, int wait_ms)
+{
+    unsigned long deadline = queue_now_ms() + wait_ms;
+    int done = 0;
+    while (0 == (done = opr(pqueue, args, num))) {
+        int left = QUEUE_WAIT_FOREVER;
+        if (QUEUE_WAIT_FOREVER != wait_ms) {
+            left = (int)(deadline - queue_now_ms());
+            if (0 >= left) break;
+        }
+        os_event_prepare(ev);
+        // check again after registered, peer may have changed it just now
+        if (0 != (done = opr(pqueue, args, num))) {
+            os_event_cancel(ev);
+            break;
+        }
+        os_event_wait(ev, left);
+    }
+    return done;
+}
 
-    // got index to write
-    ((void **)pqueue->_circ_buf.buf)[CIRC_GET_INDEX(&(pqueue->_circ_buf), index)] = arg;
-    KRNL_DEBUG("push queue %p pos %u with %p\n",
-            pqueue, index & pqueue->_circ_buf.size, arg);
+/* wait till at least one pointer moved, then wake up the peer */
+static at_error_t queue_transfer(circ_queue *pqueue, os_event *ev, os_event *peer,
+        ring_opr opr, void **args, int *num, int wait_ms)
+{
+    int done = 0;
+    if (0 > wait_ms)   // QUEUE_NO_WAIT
+        done = opr(pqueue, args, *num);
+    else if (pqueue->flags & QUEUE_F_POLL)
+        done = queue_wait_poll(pqueue, opr, args, *num, wait_ms);
+    else
+        done = queue_wait_block(pqueue, ev, opr, args, *num, wait_ms);
+    *num = done;
+    if (0 == done) return OPR_WAIT_TIMEOUT;
+    os_event_notify(peer);
     return INNER_RES_OK;
 }
 
+static at_error_t dft_queue_push(circ_queue *pqueue, void *arg, int wait_ms)
+{
+    if (NULL == pqueue || NULL == arg) return INNER_INVAILD_PARAM;
+    int num = 1;
+    at_error_t res = queue_transfer(pqueue, &pqueue->not_full, &pqueue->not_empty,
+            (pqueue->flags & QUEUE_F_SPSC) ? spsc_try_push : ring_try_push,
+            &arg, &num, wait_ms);
+    if (INNER_RES_OK == res && NULL != pqueue->notify)
+        pqueue->notify(pqueue->notify_ctx);
+    return res;
+}
+
 static at_error_t dft_queue_pop(circ_queue *pqueue, void **arg, int wait_ms)
 {
     if (NULL == pqueue || NULL == arg) return INNER_INVAILD_PARAM;
-    int index = -1;
-    for (int i = QUEUE_INTV_MS;
-        (0 == wait_ms || i < wait_ms) && -1 == (index = CIRC_READ_ONE(&pqueue->_circ_buf));
-        i+=QUEUE_INTV_MS)
-    {
-        delay_ms(QUEUE_INTV_MS);
-    }
-    if (-1 == index) return OPR_WAIT_TIMEOUT;
+    int num = 1;
+    return queue_transfer(pqueue, &pqueue->not_empty, &pqueue->not_full,
+            (pqueue->flags & QUEUE_F_SPSC) ? spsc_try_pop : ring_try_pop,
+            arg, &num, wait_ms);
+}
 
-    // got index to read
-    *arg = ((void **)pqueue->_circ_buf.buf)[CIRC_GET_INDEX(&(pqueue->_circ_buf), index)];
-    KRNL_DEBUG("pop queue %p pos %u with %p\n",
-            pqueue, index & pqueue->_circ_buf.size, *arg);
-    return INNER_RES_OK;
+static at_error_t dft_queue_push_n(circ_queue *pqueue, void **args, int *num, int wait_ms)
+{
+    if (NULL == pqueue || NULL == args || NULL == num || 0 >= *num)
+        return INNER_INVAILD_PARAM;
+    at_error_t res = queue_transfer(pqueue, &pqueue->not_full, &pqueue->not_empty,
+            (pqueue->flags & QUEUE_F_SPSC) ? spsc_try_push : ring_try_push,
+            args, num, wait_ms);
+    if (INNER_RES_OK == res && NULL != pqueue->notify)
+        pqueue->notify(pqueue->notify_ctx);
+    return res;
 }
 
-circ_queue * circ_queue_create(size_t queue_length)
+static at_error_t dft_queue_pop_n(circ_queue *pqueue, void **args, int *num, int wait_ms)
+{
+    if (NULL == pqueue || NULL == args || NULL == num || 0 >= *num)
+        return INNER_INVAILD_PARAM;
+    return queue_transfer(pqueue, &pqueue->not_empty, &pqueue->not_full,
+            (pqueue->flags & QUEUE_F_SPSC) ? spsc_try_pop : ring_try_pop,
+            args, num, wait_ms);
+}
+
+circ_queue * circ_queue_create(size_t queue_length, int flags)
 {
-    int upto2 = get_powerof2(queue_length);
-    KRNL_DEBUG("upto2 of %u: %d\n", queue_length, upto2);
     if (0 == queue_length) return NULL;
+    // the sequence scheme needs 2 slots at least
+    unsigned int size = get_powerof2(NO_LESS_THAN((int)queue_length, 2));
+    KRNL_DEBUG("upto2 of %u: %u\n", queue_length, size);
     circ_queue *pqueue = (circ_queue *)malloc(sizeof(circ_queue));
     if (NULL == pqueue) return NULL;
-    pqueue->_circ_buf.head = ATOMIC_VAR_INIT(0);
-    pqueue->_circ_buf.tail = ATOMIC_VAR_INIT(0);
-    pqueue->_circ_buf.size = upto2 - 1;
-    pqueue->_circ_buf.buf = malloc(pqueue->_circ_buf.size * sizeof(void *));
-    if (NULL == pqueue->_circ_buf.buf) {
+    pqueue->slots = (struct circ_slot *)malloc(size * sizeof(struct circ_slot));
+    if (NULL == pqueue->slots) {
+        free(pqueue);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < size; i++) {
+        atomic_init(&pqueue->slots[i].seq, i);
+        pqueue->slots[i].data = NULL;
+    }
+    atomic_init(&pqueue->tail, 0);
+    atomic_init(&pqueue->head, 0);
+    pqueue->cached_head = pqueue->cached_tail = 0;
+    pqueue->mask = size - 1;
+    pqueue->flags = flags;
+    pqueue->notify = NULL;
+    pqueue->notify_ctx = NULL;
+    if (INNER_RES_OK != os_event_init(&pqueue->not_empty)) {
+        free(pqueue->slots);
+        free(pqueue);
+        return NULL;
+    }
+    if (INNER_RES_OK != os_event_init(&pqueue->not_full)) {
+        os_event_fini(&pqueue->not_empty);
+        free(pqueue->slots);
         free(pqueue);
         return NULL;
     }
     pqueue->queue_push = dft_queue_push;
     pqueue->queue_pop = dft_queue_pop;
+    pqueue->queue_push_n = dft_queue_push_n;
+    pqueue->queue_pop_n = dft_queue_pop_n;
     return pqueue;
 };
 
+void circ_queue_set_notify(circ_queue *pqueue, on_queue_push notify, void *ctx)
+{
+    if (NULL == pqueue) return;
+    pqueue->notify_ctx = ctx;
+    pqueue->notify = notify;
+}
+
 void circ_queue_delete(circ_queue *pqueue)
 {
     if (NULL == pqueue) return;
-    if (NULL != pqueue->_circ_buf.buf) free(pqueue->_circ_buf.buf);
+    os_event_fini(&pqueue->not_empty);
+    os_event_fini(&pqueue->not_full);
+    if (NULL != pqueue->slots) free(pqueue->slots);
     free(pqueue);
 }
@@ -17,23 +17,69 @@
 
 #include "inner_err.h"
 #include "linux_circ.h"
+#include "os_sync.h"
 
 #define QUEUE_INTV_MS     10
 
+#define QUEUE_WAIT_FOREVER      0       // wait_ms: block until done
+#define QUEUE_NO_WAIT         (-1)      // wait_ms: try once and return
+
+/* flags of circ_queue_create */
+#define QUEUE_F_BLOCK       0x0000      // block on os_event, woken by peer
+#define QUEUE_F_POLL        0x0001      // sleep-poll every QUEUE_INTV_MS
+#define QUEUE_F_SPSC        0x0002      // single producer & single consumer
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 typedef struct circ_queue_t circ_queue;
 
+/***
+ * @description : callback after pointers pushed, e.g. wake up a reader
+ *                  waiting on several queues
+ * @param        {void} *ctx - context given in circ_queue_set_notify
+ * @return       {*}
+ */
+typedef void (*on_queue_push)(void *ctx);
+
+/**
+ * bounded MPMC ring with a sequence per slot (D. Vyukov):
+ *  seq == pos          slot is free for the producer of pos
+ *  seq == pos + 1      slot is filled for the consumer of pos
+ *  seq == pos + size   slot is released to the producer of next lap
+ * a producer/consumer owns its slot only after winning the CAS on tail/head,
+ * so a slot is never read before written nor overwritten before read.
+ *
+ * QUEUE_F_SPSC skips the sequences: the only producer owns tail and the only
+ * consumer owns head, each side publishes with a release store and keeps a
+ * cached copy of the opposite index, re-read only when it looks full/empty.
+ */
+struct circ_slot {
+    atomic_uint                    seq;     // sequence of slot
+    void                         *data;
+};
+
 struct circ_queue_t {
-    struct circ_buf          _circ_buf;
+    atomic_uint                   tail;     // next position to push, changing
+    unsigned int           cached_head;     // SPSC: producer's view of head
+    char   pad_tail[__Pad2Size__(atomic_uint, unsigned int)];
+    atomic_uint                   head;     // next position to pop, changing
+    unsigned int           cached_tail;     // SPSC: consumer's view of tail
+    char   pad_head[__Pad2Size__(atomic_uint, unsigned int)];
+    unsigned int                  mask;     // fixed after init, size - 1
+    struct circ_slot            *slots;     // fixed after init
+    int                          flags;     // QUEUE_F_xxx
+    os_event                 not_empty;     // consumers waiting for data
+    os_event                  not_full;     // producers waiting for space
+    on_queue_push               notify;     // extra wakeup after push
+    void                   *notify_ctx;
 
     /***
      * @description : push a pointer after tail of the queue
      * @param        {circ_queue} *pqueue - queue
      * @param        {void} *arg - pointer
-     * @param        {int} wait_ms - wait time in ms
+     * @param        {int} wait_ms - wait time in ms, 0 means forever
      * @return       {*}
      */
     at_error_t (*queue_push)(circ_queue *pqueue, void *arg, int wait_ms);
@@ -42,18 +88,39 @@ struct circ_queue_t {
      * @description : pop a pointer from head of the queue
      * @param        {circ_queue} *pqueue - queue
      * @param        {void} **arg - pointer to pointer
-     * @param        {int} wait_ms - wait time in ms
+     * @param        {int} wait_ms - wait time in ms, 0 means forever
      * @return       {*}
      */
     at_error_t (*queue_pop)(circ_queue *pqueue, void **arg, int wait_ms);
+
+    /***
+     * @description : push pointers after tail of the queue in one reservation
+     * @param        {circ_queue} *pqueue - queue
+     * @param        {void} **args - array of pointers
+     * @param        {int} *num - in: number to push, out: number pushed
+     * @param        {int} wait_ms - wait time in ms for the first one, 0 means forever
+     * @return       {*}
+     */
+    at_error_t (*queue_push_n)(circ_queue *pqueue, void **args, int *num, int wait_ms);
+
+    /***
+     * @description : pop pointers from head of the queue in one reservation
+     * @param        {circ_queue} *pqueue - queue
+     * @param        {void} **args - array of pointers
+     * @param        {int} *num - in: max number to pop, out: number popped
+     * @param        {int} wait_ms - wait time in ms for the first one, 0 means forever
+     * @return       {*}
+     */
+    at_error_t (*queue_pop_n)(circ_queue *pqueue, void **args, int *num, int wait_ms);
 };
 
 /***
  * @description : create a circualr queue
  * @param        {size_t} queue_length
+ * @param        {int} flags - QUEUE_F_xxx
  * @return       {*}
  */
-circ_queue * circ_queue_create(size_t queue_length);
+circ_queue * circ_queue_create(size_t queue_length, int flags);
 
 /***
  * @description : delete a circular queue
@@ -62,9 +129,22 @@ circ_queue * circ_queue_create(size_t queue_length);
  */
 void circ_queue_delete(circ_queue *pqueue);
 
-#define circ_queue_is_empty(pqueue) CIRC_IS_EMPTY(&(pqueue)->_circ_buf)
+/***
+ * @description : set callback invoked after each successful push
+ * @param        {circ_queue} *pqueue
+ * @param        {on_queue_push} notify - callback, NULL to clear
+ * @param        {void} *ctx - context for callback
+ * @return       {*}
+ */
+void circ_queue_set_notify(circ_queue *pqueue, on_queue_push notify, void *ctx);
+
+/* number of pointers in queue, a snapshot only under concurrency */
+#define circ_queue_count(pqueue) \
+    (atomic_load(&(pqueue)->tail) - atomic_load(&(pqueue)->head))
+
+#define circ_queue_is_empty(pqueue) (0 == circ_queue_count(pqueue))
 
-#define circ_queue_is_full(pqueue) CIRC_IS_FULL(&(pqueue)->_circ_buf)
+#define circ_queue_is_full(pqueue) (circ_queue_count(pqueue) > (pqueue)->mask)
 
 #ifdef __cplusplus
 }
@@ -10,21 +10,53 @@
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdatomic.h>
 
 #include "linux_llist.h"
+#include "lf_stack.h"
 #include "linux_macros.h"
 #include "inner_err.h"
 #include "linux_refcount.h"
+#include "blk_magazine.h"
+#include "os_sync.h"
+#include "blk_track.h"
 
 #include "data_blk.h"
 
+#if defined(CONFIG_FreeRTOS) && defined(CONFIG_DATA_BLK_SPIRAM)
+#include "esp_heap_caps.h"
+#define datablk_chunk_malloc(size) \
+    heap_caps_malloc((size), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+#define datablk_chunk_malloc(size)  malloc(size)
+#endif /* CONFIG_DATA_BLK_SPIRAM */
+
+typedef struct _datablk_chunk datablk_chunk;
+
+/* blocks grown together, released together once all of them are free */
+struct _datablk_chunk {
+    datablk_chunk                *next;
+    int                        blk_num;
+    int                       free_num;     // counted by trim
+};
+
 struct _inner_datablk {
     int                      _capacity;
     int                          _size;
+    int                         _class;     // DATABLK_STACK_NUM if from heap
     bool                        _valid;
-    struct llist_node            _node;
+    lf_node                      _node;
+    union {
+        datablk_chunk           *_chunk;     // NULL if preallocated
+        on_datablk_fini       _release;     // for embedded, called when unused
+    };
+    struct _inner_datablk      *_parent;     // block holding storage of a view
     void                        *_base;
     struct kref               refcount;     // reference counter
+    unsigned long            _alloc_ms;     // time of malloc
+#ifdef BLK_TRACK
+    blk_track                   _track;     // malloc site while in use
+#endif /* BLK_TRACK */
     datablk                      _dblk;
 };
 
@@ -32,18 +64,114 @@ struct _inner_datablk {
 
 #define TO_INNER_DATABLK(dblk)  container_of(dblk, struct _inner_datablk, _dblk)
 
+#define DATABLK_CLASS_VIEW      (-1)    // header only, on storage of another
+#define DATABLK_CLASS_EMBED     (-2)    // in memory of its owner
+
 struct _datablk_pool {
     on_datablk_init              _init;
     on_datablk_fini              _fini;
     void                         *_arg;
-    struct llist_head data_stack[DATABLK_STACK_NUM];
+    lf_stack          data_stack[DATABLK_STACK_NUM];   // depot of each class
+    int            mag_cap[DATABLK_STACK_NUM];   // magazine capacity of each class
+    os_mutex                      lock;     // for growing and trimming
+    datablk_chunk *chunks[DATABLK_STACK_NUM];   // chunks grown
+    datablk_chunk *retired[DATABLK_STACK_NUM];  // chunks trimmed, freed once no pop in flight
+    int            blk_num[DATABLK_STACK_NUM];   // blocks of each class
+    int            max_num[DATABLK_STACK_NUM];   // hard cap of each class
+    unsigned long  busy_ms[DATABLK_STACK_NUM];   // last time class ran out
+    blk_counter       stats[DATABLK_STACK_NUM + 1];     // usage, heap blocks last
+    lf_stack                view_stack;     // free headers for views
 };
 
-#define DATABLK_STACK_INDEX(blk) ((int)(((blk)->_capacity-1)/DATABLK_MIN_SIZE) < DATABLK_STACK_NUM \
-    ? (int)(((blk)->_capacity-1)/DATABLK_MIN_SIZE) : -1)
-
 static struct _datablk_pool g_datablk_pool;
 
+static __thread blk_magazine t_datablk_mag[DATABLK_STACK_NUM];
+static __thread blk_counter_local t_datablk_cnt[DATABLK_STACK_NUM + 1];
+
+/* smallest class fits size, DATABLK_STACK_NUM if none */
+static int datablk_class_fit(int size)
+{
+    int index = 0;
+    while (index < DATABLK_STACK_NUM && DATABLK_CLASS_CAP(index) < size) index++;
+    return index;
+}
+
+/* reset a free block */
+static void datablk_setup(struct _inner_datablk *blk, int index, int blk_cap,
+        datablk_chunk *chunk)
+{
+    blk->_capacity = blk_cap;
+    blk->_class = index;
+    blk->_size = 0;
+    blk->_valid = false;
+    blk->_chunk = chunk;
+    blk->_parent = NULL;
+    blk->_base = (void *)blk + SIZE_INNER_DATABLK_HEAD;
+    blk->_dblk.rd_ptr = blk->_dblk.wr_ptr = blk->_base;
+    kref_init(&blk->refcount);
+    blk->_dblk.data_type = -1;
+    INIT_LIST_HEAD(&blk->_dblk.node_msgdata);
+}
+
+/* add a chunk of free blocks to a class, lock held */
+static int datablk_grow(int index)
+{
+    int num = NO_MORE_THAN(DATABLK_GROW_NUM,
+            g_datablk_pool.max_num[index] - g_datablk_pool.blk_num[index]);
+    if (0 >= num) return 0;
+    int blk_cap = DATABLK_CLASS_CAP(index);
+    size_t stride = SIZE_INNER_DATABLK_HEAD + blk_cap;
+    datablk_chunk *chunk = (datablk_chunk *)datablk_chunk_malloc(sizeof(datablk_chunk) + num * stride);
+    if (NULL == chunk) return 0;
+    chunk->blk_num = num;
+    chunk->free_num = 0;
+
+    // link blocks and push them in one batch
+    struct llist_node *first = NULL, *last = NULL;
+    for (int j = 0; j < num; j++) {
+        struct _inner_datablk *blk = (struct _inner_datablk *)((void *)(chunk + 1) + j * stride);
+        datablk_setup(blk, index, blk_cap, chunk);
+        if (!lf_node_register(&blk->_node)) {
+            for (; NULL != first; first = first->next)
+                lf_node_unregister(container_of(first, lf_node, node));
+            free(chunk);
+            return 0;
+        }
+        blk->_node.node.next = first;
+        first = &blk->_node.node;
+        if (NULL == last) last = first;
+    }
+    chunk->next = g_datablk_pool.chunks[index];
+    g_datablk_pool.chunks[index] = chunk;
+    g_datablk_pool.blk_num[index] += num;
+    lf_stack_push_batch(&g_datablk_pool.data_stack[index], first, last);
+    KRNL_DEBUG("data block stack %d grown to %d\n", index, g_datablk_pool.blk_num[index]);
+    return num;
+}
+
+/* grow a class on exhaustion, NULL if at its hard cap */
+static struct llist_node *datablk_grow_alloc(int index)
+{
+    os_mutex_lock(&g_datablk_pool.lock);
+    g_datablk_pool.busy_ms[index] = get_sys_ms();
+    // grown or freed by others while waiting for lock
+    struct llist_node *node = lf_stack_pop(&g_datablk_pool.data_stack[index]);
+    if (NULL == node && 0 < datablk_grow(index))
+        node = lf_stack_pop(&g_datablk_pool.data_stack[index]);
+    os_mutex_unlock(&g_datablk_pool.lock);
+    return node;
+}
+
+/* free a list of chunks */
+static void datablk_free_chunks(datablk_chunk *chunk)
+{
+    while (NULL != chunk) {
+        datablk_chunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
 /***
  * @description : init data block pool
  * @param        {on_int} init_func - callback function after data block malloc
@@ -54,24 +182,27 @@ static struct _datablk_pool g_datablk_pool;
 at_error_t datablk_pool_init(on_datablk_init init_func, on_datablk_fini fini_func, void *arg)
 {
     memset(&g_datablk_pool, 0, sizeof(g_datablk_pool));
+    if (INNER_RES_OK != os_mutex_init(&g_datablk_pool.lock)) return MEMORY_MALLOC_FAILED;
+    if (INNER_RES_OK != blk_track_init()) return MEMORY_MALLOC_FAILED;
+    lf_stack_init(&g_datablk_pool.view_stack);
     for (int i = 0; i < DATABLK_STACK_NUM; i++) {
-        g_datablk_pool.data_stack[i].first = NULL;
+        lf_stack_init(&g_datablk_pool.data_stack[i]);
         int blk_num = NO_LESS_THAN(DATABLK_NUM >> i, 2);     // decrease blk num to half
-        int blk_cap = DATABLK_MIN_SIZE * (i + 1);
+        int blk_cap = DATABLK_CLASS_CAP(i);
         struct _inner_datablk *blk = NULL;
         for (int j = 0; j < blk_num; j++) {
             blk = (struct _inner_datablk *)malloc(blk_cap + SIZE_INNER_DATABLK_HEAD);
             if (NULL == blk) return MEMORY_MALLOC_FAILED;
-            blk->_capacity = blk_cap;
-            blk->_size = 0;
-            blk->_valid = false;
-            blk->_base = (void *)blk + SIZE_INNER_DATABLK_HEAD;
-            blk->_dblk.rd_ptr = blk->_dblk.wr_ptr = blk->_base;
-            kref_init(&blk->refcount);
-            blk->_dblk.data_type = -1;
-            INIT_LIST_HEAD(&blk->_dblk.node_msgdata);
-            llist_add(&blk->_node, &g_datablk_pool.data_stack[i]);
+            datablk_setup(blk, i, blk_cap, NULL);
+            if (!lf_node_register(&blk->_node)) {
+                free(blk);
+                return MEMORY_MALLOC_FAILED;
+            }
+            lf_stack_push(&g_datablk_pool.data_stack[i], &blk->_node.node);
+            g_datablk_pool.blk_num[i]++;
         }
+        g_datablk_pool.max_num[i] = NO_LESS_THAN(DATABLK_MAX_NUM >> i, blk_num);
+        g_datablk_pool.mag_cap[i] = blk_mag_cap(g_datablk_pool.max_num[i]);
     }
     g_datablk_pool._init = init_func;
     g_datablk_pool._fini = fini_func;
@@ -86,40 +217,71 @@ at_error_t datablk_pool_init(on_datablk_init init_func, on_datablk_fini fini_fun
  */
 void datablk_pool_fini(void)
 {
+    datablk_thread_flush();
     for (int i = 0; i < DATABLK_STACK_NUM; i++) {
         struct llist_node *node = NULL;
-        while (NULL != (node = llist_del_first(&g_datablk_pool.data_stack[i]))) {
+        while (NULL != (node = lf_stack_pop(&g_datablk_pool.data_stack[i]))) {
             struct _inner_datablk *blk = container_of(node, struct _inner_datablk, _node);
-            free(blk);
+            lf_node_unregister(&blk->_node);
+            if (NULL == blk->_chunk) free(blk);     // blocks grown go with chunks
         }
+        datablk_free_chunks(g_datablk_pool.chunks[i]);
+        datablk_free_chunks(g_datablk_pool.retired[i]);
+        g_datablk_pool.chunks[i] = g_datablk_pool.retired[i] = NULL;
     }
+    struct llist_node *node = NULL;
+    while (NULL != (node = lf_stack_pop(&g_datablk_pool.view_stack))) {
+        lf_node_unregister(container_of(node, lf_node, node));
+        free(container_of(node, struct _inner_datablk, _node));
+    }
+    os_mutex_fini(&g_datablk_pool.lock);
     KRNL_DEBUG("data block pool fini\n");
 }
 
-/***
- * @description : malloc data block
- * @param        {int} size - desired size of data block
- * @return       {*} - pointer to data block, got NULL if failed
- */
-datablk * datablk_malloc(int size)
+/* malloc a block larger than any class from heap */
+static struct _inner_datablk *datablk_heap_alloc(int size)
+{
+    struct _inner_datablk *blk = (struct _inner_datablk *)malloc(size + SIZE_INNER_DATABLK_HEAD);
+    if (NULL == blk) return NULL;
+    datablk_setup(blk, DATABLK_STACK_NUM, size, NULL);
+    KRNL_DEBUG("malloc size %d from heap, blk %p\n", size, blk);
+    return blk;
+}
+
+/* malloc data block, zero requested bytes or leave them as is, site for tracking */
+static datablk *datablk_alloc(int size, bool zero, const void *site)
 {
-    int stack_index = (int)((size-1)/DATABLK_MIN_SIZE) < DATABLK_STACK_NUM \
-            ? (int)((size-1)/DATABLK_MIN_SIZE) : -1;
+    if (0 > size) return NULL;
+    int stack_index = datablk_class_fit(size);
     KRNL_DEBUG("malloc size %d, stack %d\n", size, stack_index);
-    if (-1 == stack_index) return NULL;
 
-    // find possible stack
+    // find possible stack, magazine of this thread first
+    struct llist_node *node = NULL;
+    struct _inner_datablk *blk = NULL;
+    int fit_index = stack_index;
     for (; stack_index < DATABLK_STACK_NUM; stack_index++) {
-        if (!llist_empty(&g_datablk_pool.data_stack[stack_index])) break;
+        node = blk_mag_alloc(&t_datablk_mag[stack_index],
+                g_datablk_pool.mag_cap[stack_index], &g_datablk_pool.data_stack[stack_index]);
+        if (NULL != node) break;
         else KRNL_DEBUG("malloc size %d, stack %d empty\n", size, stack_index);
     }
+    if (DATABLK_STACK_NUM == fit_index) {
+        blk = datablk_heap_alloc(size);
+        if (NULL != blk) node = &blk->_node.node;
+    } else if (NULL == node) {
+        // all stacks fit are empty, grow the best fit one
+        stack_index = fit_index;
+        node = datablk_grow_alloc(stack_index);
+    }
     KRNL_DEBUG("malloc size %d, serached stack %d\n", size, stack_index);
-    if (DATABLK_STACK_NUM <= stack_index) return NULL;
-
-    struct llist_node *node = llist_del_first(
-                &g_datablk_pool.data_stack[stack_index]);
-    if (NULL == node) return NULL;
-    struct _inner_datablk *blk = container_of(node, struct _inner_datablk, _node);
+    if (NULL == node) {
+        blk_counter_fail(&g_datablk_pool.stats[fit_index]);
+        return NULL;
+    }
+    blk = container_of(node, struct _inner_datablk, _node);
+    if (fit_index != blk->_class) blk_counter_fallback(&g_datablk_pool.stats[fit_index]);
+    blk_counter_local_alloc(&g_datablk_pool.stats[blk->_class], &t_datablk_cnt[blk->_class], size);
+    blk->_alloc_ms = get_sys_ms();
     KRNL_DEBUG("malloc size %d, serached stack %d, node %p, data %p, blk %p, cap %d\n",
             size, stack_index, node, &blk->_dblk, blk, blk->_capacity);
     blk->_size = size;
@@ -128,7 +290,9 @@ datablk * datablk_malloc(int size)
     blk->_dblk.data_type = -1;
     kref_init(&blk->refcount);  // reset reference to 1
     blk->_dblk.rd_ptr = blk->_dblk.wr_ptr = blk->_base;
-    memset(blk->_base, 0, blk->_capacity);
+    if (zero) memset(blk->_base, 0, size);
+    else blk_poison(blk->_base, blk->_capacity);
+    blk_track_add(&blk->_track, "datablk", &blk->_dblk, site);
     KRNL_DEBUG("===malloc size %d, serached stack %d, node %p, data %p, blk %p, cap %d\n",
             size, stack_index, node, &blk->_dblk, blk, blk->_capacity);
     if (NULL != g_datablk_pool._init)
@@ -140,18 +304,287 @@ datablk * datablk_malloc(int size)
     return &blk->_dblk;
 }
 
+/***
+ * @description : malloc data block, from heap if larger than DATABLK_MAX_SIZE,
+ *                  content not cleared
+ * @param        {int} size - desired size of data block
+ * @return       {*} - pointer to data block, got NULL if failed
+ */
+datablk * datablk_malloc(int size)
+{
+    return datablk_alloc(size, false, BLK_CALLER());
+}
+
+/***
+ * @description : datablk_malloc tracked at site of its caller, for allocators
+ *                  built on data blocks
+ * @param        {int} size - desired size of data block
+ * @param        {void} *site - caller tracked as allocating it
+ * @return       {*} - pointer to data block, got NULL if failed
+ */
+datablk *datablk_malloc_at(int size, const void *site)
+{
+    return datablk_alloc(size, false, site);
+}
+
+/***
+ * @description : malloc data block with size bytes cleared
+ * @param        {int} size - desired size of data block
+ * @return       {*} - pointer to data block, got NULL if failed
+ */
+datablk * datablk_calloc(int size)
+{
+    return datablk_alloc(size, true, BLK_CALLER());
+}
+
 static void __datablk_release(struct kref *ref)
 {
     struct _inner_datablk *blk = container_of(ref, struct _inner_datablk, refcount);
+    if (NULL != blk->_parent) {
+        // view, release the storage it shares
+        struct _inner_datablk *parent = blk->_parent;
+        blk_track_del(&blk->_track);
+        blk->_parent = NULL;
+        lf_stack_push(&g_datablk_pool.view_stack, &blk->_node.node);
+        kref_put(&parent->refcount, __datablk_release);
+        return;
+    }
+    if (DATABLK_CLASS_EMBED == blk->_class) {
+        blk_poison(blk->_base, blk->_capacity);
+        blk->_release(&blk->_dblk, blk);
+        return;
+    }
     if (NULL != g_datablk_pool._fini)
         g_datablk_pool._fini(&blk->_dblk, g_datablk_pool._arg);
+    blk_track_del(&blk->_track);
 
+    int index = blk->_class;
     KRNL_DEBUG("free size %d, stack %d, node %p, data %p, blk %p, cap %d\n",
-            blk->_size, DATABLK_STACK_INDEX(blk), &blk->_node, &blk->_dblk, blk, blk->_capacity);
+            blk->_size, index, &blk->_node, &blk->_dblk, blk, blk->_capacity);
+    blk_counter_local_free(&g_datablk_pool.stats[index], &t_datablk_cnt[index],
+            blk->_size, get_sys_ms() - blk->_alloc_ms);
+    blk_poison(blk->_base, blk->_capacity);
+    if (DATABLK_STACK_NUM == index) {
+        free(blk);
+        return;
+    }
     blk->_size = 0;
     blk->_valid = false;
     INIT_LIST_HEAD(&blk->_dblk.node_msgdata);
-    llist_add(&blk->_node, &g_datablk_pool.data_stack[DATABLK_STACK_INDEX(blk)]);
+    blk_mag_free(&t_datablk_mag[index], g_datablk_pool.mag_cap[index],
+            &blk->_node.node, &g_datablk_pool.data_stack[index]);
+}
+
+/* make a view on data of db from base, headers of views are kept for reuse */
+static datablk *datablk_view(datablk *db, void *base, int size, const void *site)
+{
+    struct _inner_datablk *org = TO_INNER_DATABLK(db);
+    struct _inner_datablk *parent = NULL != org->_parent ? org->_parent : org;
+    struct _inner_datablk *view;
+    struct llist_node *node = lf_stack_pop(&g_datablk_pool.view_stack);
+    if (NULL != node) view = container_of(node, struct _inner_datablk, _node);
+    else if (NULL == (view = (struct _inner_datablk *)malloc(SIZE_INNER_DATABLK_HEAD)))
+        return NULL;
+    else if (!lf_node_register(&view->_node)) {
+        free(view);
+        return NULL;
+    }
+
+    view->_capacity = view->_size = size;
+    view->_class = DATABLK_CLASS_VIEW;
+    view->_valid = org->_valid;
+    view->_chunk = NULL;
+    view->_parent = parent;
+    view->_base = base;
+    view->_dblk.rd_ptr = base;
+    view->_dblk.wr_ptr = base + size;
+    view->_dblk.data_type = db->data_type;
+    INIT_LIST_HEAD(&view->_dblk.node_msgdata);
+    kref_init(&view->refcount);
+    kref_get(&parent->refcount);    // storage held by view
+    blk_track_add(&view->_track, "view", &view->_dblk, site);
+    return &view->_dblk;
+}
+
+/***
+ * @description : get memory needed to embed a data block of capacity cap
+ * @param        {int} cap - capacity of data block
+ * @return       {*}
+ */
+int datablk_embed_size(int cap)
+{
+    return SIZE_INNER_DATABLK_HEAD + cap;
+}
+
+/***
+ * @description : make a data block in memory of its owner, callbacks of pool
+ *                  not called, release called when the last reference freed
+ * @param        {void} *mem - memory of datablk_embed_size(cap) bytes, aligned
+ * @param        {int} cap - capacity of data block
+ * @param        {int} size - desired size of data block
+ * @param        {on_datablk_fini} release - called with mem as arg when unused
+ * @return       {*} - pointer to data block, got NULL if size over cap
+ */
+datablk *datablk_embed(void *mem, int cap, int size, on_datablk_fini release)
+{
+    if (NULL == mem || NULL == release || 0 > size || size > cap) return NULL;
+    struct _inner_datablk *blk = (struct _inner_datablk *)mem;
+    datablk_setup(blk, DATABLK_CLASS_EMBED, cap, NULL);
+    blk->_release = release;
+    blk->_size = size;
+    blk_poison(blk->_base, cap);
+    return &blk->_dblk;
+}
+
+/***
+ * @description : get a view on part of data in data block without copy,
+ *                  data shared with db and kept until the view freed
+ * @param        {datablk} *db - pointer to data block
+ * @param        {int} off - offset from read pointer
+ * @param        {int} len - length of the view
+ * @return       {*} - pointer to view, got NULL if out of range or failed
+ */
+datablk *datablk_slice(datablk *db, int off, int len)
+{
+    if (NULL == db || 0 > off || 0 > len || off + len > datablk_length(db)) return NULL;
+    return datablk_view(db, db->rd_ptr + off, len, BLK_CALLER());
+}
+
+/***
+ * @description : get a view on all data in data block without copy,
+ *                  with read and write pointer of its own
+ * @param        {datablk} *db - pointer to data block
+ * @return       {*} - pointer to view, got NULL if failed
+ */
+datablk *datablk_clone(datablk *db)
+{
+    if (NULL == db) return NULL;
+    datablk *view = datablk_view(db, datablk_get_base(db), datablk_ocupied(db), BLK_CALLER());
+    if (NULL != view) view->rd_ptr = db->rd_ptr;
+    return view;
+}
+
+/***
+ * @description : return chunks grown and idle for DATABLK_TRIM_MS to heap,
+ *                  call periodically, e.g. from a housekeeping loop, their
+ *                  memory freed by a later call seeing no pop of the class
+ * @return       {*} - number of blocks returned
+ */
+int datablk_pool_trim(void)
+{
+    int trimmed = 0;
+    unsigned long now = get_sys_ms();
+    // blocks cached by the caller, e.g. a main loop, count as free too
+    datablk_thread_flush();
+    os_mutex_lock(&g_datablk_pool.lock);
+    for (int i = 0; i < DATABLK_STACK_NUM; i++) {
+        // a pop racing with last trim may still read a node retired, until none in flight
+        if (NULL != g_datablk_pool.retired[i] && lf_stack_idle(&g_datablk_pool.data_stack[i])) {
+            datablk_free_chunks(g_datablk_pool.retired[i]);
+            g_datablk_pool.retired[i] = NULL;
+        }
+        if (NULL == g_datablk_pool.chunks[i]
+            || DATABLK_TRIM_MS > (long)(now - g_datablk_pool.busy_ms[i])) continue;
+
+        // take free blocks out, count them by chunk
+        datablk_chunk *chunk;
+        for (chunk = g_datablk_pool.chunks[i]; NULL != chunk; chunk = chunk->next)
+            chunk->free_num = 0;
+        struct llist_node *list = NULL, *node;
+        while (NULL != (node = lf_stack_pop(&g_datablk_pool.data_stack[i]))) {
+            struct _inner_datablk *blk = container_of(node, struct _inner_datablk, _node);
+            if (NULL != blk->_chunk) blk->_chunk->free_num++;
+            node->next = list;
+            list = node;
+        }
+
+        // retire chunks with all blocks free
+        datablk_chunk **pchunk = &g_datablk_pool.chunks[i];
+        while (NULL != (chunk = *pchunk)) {
+            if (chunk->free_num == chunk->blk_num) {
+                *pchunk = chunk->next;
+                chunk->next = g_datablk_pool.retired[i];
+                g_datablk_pool.retired[i] = chunk;
+                g_datablk_pool.blk_num[i] -= chunk->blk_num;
+                trimmed += chunk->blk_num;
+            } else pchunk = &chunk->next;
+        }
+
+        // put the rest back in one batch
+        struct llist_node *first = NULL, *last = NULL;
+        while (NULL != (node = list)) {
+            list = node->next;
+            struct _inner_datablk *blk = container_of(node, struct _inner_datablk, _node);
+            if (NULL != blk->_chunk && blk->_chunk->free_num == blk->_chunk->blk_num) {
+                lf_node_unregister(&blk->_node);    // memory freed by a later trim
+                continue;
+            }
+            node->next = first;
+            first = node;
+            if (NULL == last) last = first;
+        }
+        if (NULL != first) lf_stack_push_batch(&g_datablk_pool.data_stack[i], first, last);
+        KRNL_DEBUG("data block stack %d trimmed to %d\n", i, g_datablk_pool.blk_num[i]);
+    }
+    os_mutex_unlock(&g_datablk_pool.lock);
+    return trimmed;
+}
+
+/***
+ * @description : get usage of a size class, internal fragmentation is
+ *                  wasted_bytes of capacity in use
+ * @param        {int} index - class index, DATABLK_STACK_NUM for heap blocks
+ * @param        {blk_stats} *stats - usage got
+ * @return       {*}
+ */
+at_error_t datablk_pool_stats(int index, blk_stats *stats)
+{
+    if (0 > index || DATABLK_STACK_NUM < index || NULL == stats) return INNER_INVAILD_PARAM;
+    blk_counter_read(&g_datablk_pool.stats[index], stats);
+    if (DATABLK_STACK_NUM == index) {
+        stats->capacity = 0;
+        stats->blk_num = stats->used_num;
+        stats->wasted_bytes = 0;
+    } else {
+        stats->capacity = DATABLK_CLASS_CAP(index);
+        stats->blk_num = g_datablk_pool.blk_num[index];
+        stats->wasted_bytes = (long)stats->used_num * stats->capacity - stats->used_bytes;
+    }
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : log usage and internal fragmentation of each size class
+ * @return       {*}
+ */
+void datablk_pool_dump(void)
+{
+    blk_stats stats;
+    for (int i = 0; i < DATABLK_STACK_NUM; i++) {
+        datablk_pool_stats(i, &stats);
+        long in_use = (long)stats.used_num * stats.capacity;
+        KRNL_INFO("data block stack %d: cap %d, used %d/%d, peak %d, fail %u, fallback %u, "
+                "hold %u ms, bytes %ld/%ld, wasted %ld%%\n",
+                i, stats.capacity, stats.used_num, stats.blk_num, stats.peak_num,
+                stats.fail_num, stats.fallback_num, stats.avg_hold_ms,
+                stats.used_bytes, in_use, 0 < in_use ? stats.wasted_bytes * 100 / in_use : 0);
+    }
+    datablk_pool_stats(DATABLK_STACK_NUM, &stats);
+    KRNL_INFO("data block heap: used %d, peak %d, fail %u, hold %u ms, bytes %ld\n",
+            stats.used_num, stats.peak_num, stats.fail_num, stats.avg_hold_ms, stats.used_bytes);
+}
+
+/***
+ * @description : return data blocks cached by current thread to pool and
+ *                  fold its usage counters, call before a thread using data blocks ends
+ * @return       {*}
+ */
+void datablk_thread_flush(void)
+{
+    for (int i = 0; i < DATABLK_STACK_NUM; i++)
+        blk_mag_flush(&t_datablk_mag[i], &g_datablk_pool.data_stack[i]);
+    for (int i = 0; i <= DATABLK_STACK_NUM; i++)
+        blk_counter_fold(&g_datablk_pool.stats[i], &t_datablk_cnt[i]);
 }
 
 /***
@@ -165,6 +598,12 @@ void datablk_free(datablk *db)
     if (NULL == db) return;
 
     struct _inner_datablk *blk = container_of(db, struct _inner_datablk, _dblk);
+#ifdef BLK_TRACK
+    if (DATABLK_CLASS_EMBED != blk->_class && 0 == kref_read(&blk->refcount)) {
+        blk_track_double_free(&blk->_track, db, BLK_CALLER());
+        return;
+    }
+#endif /* BLK_TRACK */
     // decrease reference, if 0 recycle with fini
     kref_put(&blk->refcount, __datablk_release);  // decrease reference
 }
@@ -13,19 +13,68 @@
 #include "inner_err.h"
 #include "linux_macros.h"
 #include "linux_list.h"
+#include "blk_stats.h"
 
 #ifndef DATABLK_MIN_SIZE
+#ifdef CONFIG_DATA_BLK_MIN
+#define DATABLK_MIN_SIZE    CONFIG_DATA_BLK_MIN
+#else
 #define DATABLK_MIN_SIZE    32
+#endif /* CONFIG_DATA_BLK_MIN */
 #endif /* DATABLK_MIN_SIZE */
 
 #ifndef DATABLK_NUM
+#ifdef CONFIG_DATA_BLK_NUM
+#define DATABLK_NUM     CONFIG_DATA_BLK_NUM
+#else
 #define DATABLK_NUM     8
+#endif /* CONFIG_DATA_BLK_NUM */
 #endif /* DATABLK_NUM */
 
 #ifndef DATABLK_STACK_NUM
+#ifdef CONFIG_DATA_BLK_STACK
+#define DATABLK_STACK_NUM    CONFIG_DATA_BLK_STACK
+#else
 #define DATABLK_STACK_NUM    3
+#endif /* CONFIG_DATA_BLK_STACK */
 #endif /* DATABLK_STACK_NUM */
 
+/*
+ * capacity of class i doubles from DATABLK_MIN_SIZE, larger blocks are
+ * allocated from heap directly
+ */
+#define DATABLK_CLASS_CAP(i)    (DATABLK_MIN_SIZE << (i))
+#define DATABLK_MAX_SIZE        DATABLK_CLASS_CAP(DATABLK_STACK_NUM - 1)
+
+/*
+ * blocks of class i: DATABLK_NUM >> i preallocated and kept (low watermark),
+ * grown DATABLK_GROW_NUM a time on exhaustion up to DATABLK_MAX_NUM >> i
+ * (high watermark), chunks grown are returned after DATABLK_TRIM_MS idle
+ */
+#ifndef DATABLK_MAX_NUM
+#ifdef CONFIG_DATA_BLK_MAX
+#define DATABLK_MAX_NUM     CONFIG_DATA_BLK_MAX
+#else
+#define DATABLK_MAX_NUM     32
+#endif /* CONFIG_DATA_BLK_MAX */
+#endif /* DATABLK_MAX_NUM */
+
+#ifndef DATABLK_GROW_NUM
+#ifdef CONFIG_DATA_BLK_GROW
+#define DATABLK_GROW_NUM    CONFIG_DATA_BLK_GROW
+#else
+#define DATABLK_GROW_NUM    4
+#endif /* CONFIG_DATA_BLK_GROW */
+#endif /* DATABLK_GROW_NUM */
+
+#ifndef DATABLK_TRIM_MS
+#ifdef CONFIG_DATA_BLK_TRIM_MS
+#define DATABLK_TRIM_MS     CONFIG_DATA_BLK_TRIM_MS
+#else
+#define DATABLK_TRIM_MS     30000
+#endif /* CONFIG_DATA_BLK_TRIM_MS */
+#endif /* DATABLK_TRIM_MS */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -93,12 +142,98 @@ at_error_t datablk_pool_init(on_datablk_init init_func, on_datablk_fini fini_fun
 void datablk_pool_fini(void);
 
 /***
- * @description : malloc data block
+ * @description : return chunks grown and idle for DATABLK_TRIM_MS to heap,
+ *                  call periodically, e.g. from a housekeeping loop, their
+ *                  memory freed by a later call seeing no pop of the class,
+ *                  data blocks cached by the calling thread flushed first
+ * @return       {*} - number of blocks returned
+ */
+int datablk_pool_trim(void);
+
+/***
+ * @description : get usage of a size class, internal fragmentation is
+ *                  wasted_bytes of capacity in use
+ * @param        {int} index - class index, DATABLK_STACK_NUM for heap blocks
+ * @param        {blk_stats} *stats - usage got
+ * @return       {*}
+ */
+at_error_t datablk_pool_stats(int index, blk_stats *stats);
+
+/***
+ * @description : log usage and internal fragmentation of each size class
+ * @return       {*}
+ */
+void datablk_pool_dump(void);
+
+/***
+ * @description : return data blocks cached by current thread to pool and
+ *                  fold its usage counters, done when an active task ends,
+ *                  other threads using data blocks call it before they end,
+ *                  or now and then if never ending, e.g. event handlers
+ * @return       {*}
+ */
+void datablk_thread_flush(void);
+
+/***
+ * @description : malloc data block, from heap if larger than DATABLK_MAX_SIZE,
+ *                  content not cleared
  * @param        {int} size - desired size of data block
  * @return       {*} - pointer to data block, got NULL if failed
  */
 datablk * datablk_malloc(int size);
 
+/***
+ * @description : datablk_malloc tracked at site of its caller, for allocators
+ *                  built on data blocks
+ * @param        {int} size - desired size of data block
+ * @param        {void} *site - caller tracked as allocating it
+ * @return       {*} - pointer to data block, got NULL if failed
+ */
+datablk *datablk_malloc_at(int size, const void *site);
+
+/***
+ * @description : malloc data block with size bytes cleared
+ * @param        {int} size - desired size of data block
+ * @return       {*} - pointer to data block, got NULL if failed
+ */
+datablk * datablk_calloc(int size);
+
+/***
+ * @description : get memory needed to embed a data block of capacity cap
+ * @param        {int} cap - capacity of data block
+ * @return       {*}
+ */
+int datablk_embed_size(int cap);
+
+/***
+ * @description : make a data block in memory of its owner, callbacks of pool
+ *                  not called, release called when the last reference freed
+ * @param        {void} *mem - memory of datablk_embed_size(cap) bytes, aligned
+ * @param        {int} cap - capacity of data block
+ * @param        {int} size - desired size of data block
+ * @param        {on_datablk_fini} release - called with mem as arg when unused
+ * @return       {*} - pointer to data block, got NULL if size over cap
+ */
+datablk *datablk_embed(void *mem, int cap, int size, on_datablk_fini release);
+
+/***
+ * @description : get a view on part of data in data block without copy,
+ *                  data shared with db and kept until the view freed
+ * @param        {datablk} *db - pointer to data block
+ * @param        {int} off - offset from read pointer
+ * @param        {int} len - length of the view
+ * @return       {*} - pointer to view, got NULL if out of range or failed
+ */
+datablk *datablk_slice(datablk *db, int off, int len);
+
+/***
+ * @description : get a view on all data in data block without copy,
+ *                  with read and write pointer of its own
+ * @param        {datablk} *db - pointer to data block
+ * @return       {*} - pointer to view, got NULL if failed
+ */
+datablk *datablk_clone(datablk *db);
+
 /***
  * @description : clear data block, decrease reference
  *                  data block would be release if reference = 0
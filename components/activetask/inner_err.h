@@ -38,6 +38,10 @@
 #define TASK_NOT_EXIST              (INNER_MSG_ERR_BASE+ 9)
 #define TASK_NEXT_NOT_EXIST         (INNER_MSG_ERR_BASE+10)
 #define TASK_FAILED_CREATE          (INNER_MSG_ERR_BASE+11)
+#define TASK_QUEUE_EXCLUSIVE        (INNER_MSG_ERR_BASE+12)
+#define TIMER_WHEEL_STOPPED         (INNER_MSG_ERR_BASE+13)
+#define EXECUTOR_NOT_RUNNING        (INNER_MSG_ERR_BASE+14)
+#define TASK_NOT_RUNNING            (INNER_MSG_ERR_BASE+15)
 
 #define INNER_N2N_ERR_BASE          0x420000
 #define N2N_EMPTY_DEV_INFO          (INNER_N2N_ERR_BASE+ 1)
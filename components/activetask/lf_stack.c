@@ -0,0 +1,83 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 19:12:08
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 19:12:08
+ * @FilePath    : /activetask/components/activetask/lf_stack.c
+ * @Description : node table of lock-free stacks
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lf_stack.h"
+
+_Atomic(lf_node *) *_Atomic g_lf_node_pages[LF_NODE_PAGES];
+
+static atomic_uint g_lf_node_next = 1;  // next index never used
+
+/* page of index, allocated if not yet */
+static _Atomic(lf_node *) *lf_node_page(unsigned int idx)
+{
+    _Atomic(lf_node *) *page = atomic_load(&g_lf_node_pages[idx >> LF_NODE_PAGE_BITS]);
+    if (NULL != page) return page;
+
+    _Atomic(lf_node *) *fresh = calloc(LF_NODE_PAGE_SIZE, sizeof(_Atomic(lf_node *)));
+    if (NULL == fresh) return NULL;
+    for (int i = 0; i < LF_NODE_PAGE_SIZE; i++) atomic_init(&fresh[i], NULL);
+    if (!atomic_compare_exchange_strong(&g_lf_node_pages[idx >> LF_NODE_PAGE_BITS],
+            &page, fresh)) {
+        free(fresh);    // allocated by another thread
+        return page;
+    }
+    return fresh;
+}
+
+/* claim slot of idx for node */
+static bool lf_node_claim(lf_node *node, unsigned int idx)
+{
+    _Atomic(lf_node *) *page = lf_node_page(idx);
+    if (NULL == page) return false;
+    lf_node *empty = NULL;
+    if (!atomic_compare_exchange_strong(&page[idx & (LF_NODE_PAGE_SIZE - 1)], &empty, node))
+        return false;
+    node->idx = (uint16_t)idx;
+    return true;
+}
+
+/***
+ * @description : give node an index, must be done before first push
+ * @param        {lf_node} *node - pointer to node
+ * @return       {*} - false if no index or memory left
+ */
+bool lf_node_register(lf_node *node)
+{
+    if (NULL == node) return false;
+    node->node.next = NULL;
+    atomic_init(&node->next_idx, 0);
+
+    // fresh index first, then one given back
+    unsigned int idx = atomic_load(&g_lf_node_next);
+    while (LF_NODE_MAX >= idx) {
+        if (atomic_compare_exchange_weak(&g_lf_node_next, &idx, idx + 1))
+            return lf_node_claim(node, idx);
+    }
+    for (idx = 1; idx <= LF_NODE_MAX; idx++) {
+        if (NULL == lf_node_at(idx) && lf_node_claim(node, idx)) return true;
+    }
+    KRNL_ERROR("no index left for lock-free stack node %p\n", node);
+    return false;
+}
+
+/***
+ * @description : take index back, node must not be in any stack
+ * @param        {lf_node} *node - pointer to node
+ * @return       {*}
+ */
+void lf_node_unregister(lf_node *node)
+{
+    if (NULL == node || 0 == node->idx) return;
+    _Atomic(lf_node *) *page = atomic_load(&g_lf_node_pages[node->idx >> LF_NODE_PAGE_BITS]);
+    atomic_store(&page[node->idx & (LF_NODE_PAGE_SIZE - 1)], NULL);
+    node->idx = 0;
+}
@@ -0,0 +1,175 @@
+/***
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 19:12:08
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 19:12:08
+ * @FilePath    : /activetask/components/activetask/lf_stack.h
+ * @Description : ABA-safe lock-free stack of llist_node with tagged top
+ * @Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#ifndef _LF_STACK_H_
+#define _LF_STACK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "linux_macros.h"
+#include "linux_llist.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef LF_NODE_IDX_BITS
+#ifdef CONFIG_LF_NODE_IDX_BITS
+#define LF_NODE_IDX_BITS    CONFIG_LF_NODE_IDX_BITS
+#else
+#define LF_NODE_IDX_BITS    12      // 4095 nodes registered at most
+#endif /* CONFIG_LF_NODE_IDX_BITS */
+#endif /* LF_NODE_IDX_BITS */
+
+/**
+ * llist_del_first allows a single deleter only: a pop reading first->next may
+ * race with another pop and push of the same node (ABA) and link a node in use
+ * back. Here the top is one word, index of the first node in the low
+ * LF_NODE_IDX_BITS and a tag bumped by every pop above, so that a stale CAS
+ * fails and the CAS is native: 32 bits on chips, a 20-bit tag by default, and
+ * 64 bits on Linux hosts. A stale CAS still succeeds if its pop was held up
+ * between reading top and CAS while exactly a multiple of 2^20 pops were done
+ * on the same stack, about a second of pops on ESP32 for a preempted task.
+ *
+ * A node gets its index from lf_node_register before it's first pushed, and
+ * gives it back by lf_node_unregister before its memory is freed. The stack
+ * links nodes by index of next, llist_node next is only used to pass a chain
+ * to lf_stack_push_batch.
+ *
+ * A loser of the race may still read next index of a node popped by others,
+ * so memory of a node unregistered is freed only once lf_stack_idle saw no pop
+ * in flight on its stack after.
+ */
+typedef struct {
+    struct llist_node             node;     // first, passed as llist_node
+    uint16_t                       idx;     // slot in node table, 0 if none
+    atomic_ushort             next_idx;     // next node while in stack, read by racing pops
+} lf_node;
+
+#if defined(__linux__) || defined(__linux)
+typedef uint64_t lf_top_t;
+#elif defined(CONFIG_FreeRTOS)
+typedef uint32_t lf_top_t;
+#endif /* __linux__ */
+
+typedef struct {
+    _Atomic lf_top_t               top;     // tag << LF_NODE_IDX_BITS | index of first node
+    atomic_uint                   pops;     // pops in flight
+} lf_stack;
+
+#define LF_NODE_MAX         ((1u << LF_NODE_IDX_BITS) - 1)
+#define LF_NODE_PAGE_BITS   (LF_NODE_IDX_BITS < 8 ? LF_NODE_IDX_BITS : 8)
+#define LF_NODE_PAGE_SIZE   (1 << LF_NODE_PAGE_BITS)
+#define LF_NODE_PAGES       (1 << (LF_NODE_IDX_BITS - LF_NODE_PAGE_BITS))
+
+_Static_assert(LF_NODE_IDX_BITS <= 16, "index of node must fit in lf_node");
+
+#define LF_TOP_IDX(top)         ((unsigned int)((top) & LF_NODE_MAX))
+#define LF_TOP_TAG(top)         ((top) >> LF_NODE_IDX_BITS)
+#define LF_TOP(idx, tag)        ((lf_top_t)(idx) | ((lf_top_t)(tag) << LF_NODE_IDX_BITS))
+
+/* node table in pages allocated on demand, index 0 for none */
+extern _Atomic(lf_node *) *_Atomic g_lf_node_pages[LF_NODE_PAGES];
+
+/***
+ * @description : give node an index, must be done before first push
+ * @param        {lf_node} *node - pointer to node
+ * @return       {*} - false if no index or memory left
+ */
+bool lf_node_register(lf_node *node);
+
+/***
+ * @description : take index back, node must not be in any stack
+ * @param        {lf_node} *node - pointer to node
+ * @return       {*}
+ */
+void lf_node_unregister(lf_node *node);
+
+/* node of index, NULL if unregistered */
+static inline lf_node *lf_node_at(unsigned int idx)
+{
+    // index was published by a release push, so the slot written before is seen
+    _Atomic(lf_node *) *page = atomic_load_explicit(
+            &g_lf_node_pages[idx >> LF_NODE_PAGE_BITS], memory_order_relaxed);
+    if (NULL == page) return NULL;
+    return atomic_load_explicit(&page[idx & (LF_NODE_PAGE_SIZE - 1)], memory_order_relaxed);
+}
+
+static inline void lf_stack_init(lf_stack *stack)
+{
+    atomic_init(&stack->top, 0);
+    atomic_init(&stack->pops, 0);
+}
+
+/* no pop in flight, nodes unregistered before may be freed */
+static inline bool lf_stack_idle(lf_stack *stack)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    return 0 == atomic_load(&stack->pops);
+}
+
+static inline bool lf_stack_empty(lf_stack *stack)
+{
+    return 0 == LF_TOP_IDX(atomic_load_explicit(&stack->top, memory_order_relaxed));
+}
+
+/* push a chain of nodes linked from new_first to new_last */
+static inline void lf_stack_push_batch(lf_stack *stack, struct llist_node *new_first,
+        struct llist_node *new_last)
+{
+    lf_node *last = container_of(new_last, lf_node, node);
+    for (struct llist_node *n = new_first; n != new_last; n = n->next)
+        atomic_store_explicit(&container_of(n, lf_node, node)->next_idx,
+                container_of(n->next, lf_node, node)->idx, memory_order_relaxed);
+    lf_top_t top = atomic_load_explicit(&stack->top, memory_order_relaxed);
+    lf_top_t next;
+    do {
+        atomic_store_explicit(&last->next_idx, LF_TOP_IDX(top), memory_order_relaxed);
+        next = LF_TOP(container_of(new_first, lf_node, node)->idx, LF_TOP_TAG(top));
+    } while (!atomic_compare_exchange_weak_explicit(&stack->top, &top, next,
+            memory_order_release, memory_order_relaxed));
+}
+
+static inline void lf_stack_push(lf_stack *stack, struct llist_node *node)
+{
+    lf_stack_push_batch(stack, node, node);
+}
+
+static inline struct llist_node *lf_stack_pop(lf_stack *stack)
+{
+    // counted before top is read, so lf_stack_idle waits for this pop
+    atomic_fetch_add(&stack->pops, 1);
+    lf_node *first = NULL;
+    lf_top_t top = atomic_load_explicit(&stack->top, memory_order_acquire);
+    while (0 != LF_TOP_IDX(top)) {
+        first = lf_node_at(LF_TOP_IDX(top));
+        if (NULL == first) {
+            // node left its pool after top was read, top has changed
+            top = atomic_load_explicit(&stack->top, memory_order_acquire);
+            continue;
+        }
+        lf_top_t next = LF_TOP(atomic_load_explicit(&first->next_idx, memory_order_relaxed),
+                LF_TOP_TAG(top) + 1);
+        if (atomic_compare_exchange_weak_explicit(&stack->top, &top, next,
+                memory_order_acquire, memory_order_acquire))
+            break;
+        first = NULL;
+    }
+    atomic_fetch_sub_explicit(&stack->pops, 1, memory_order_release);
+    return NULL == first ? NULL : &first->node;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _LF_STACK_H_ */
@@ -15,9 +15,7 @@
 #include <stdbool.h>
 #include <string.h>
 
-#if defined(CONFIG_FreeRTOS)
-#include "mbedtls/md5.h"
-#endif /* _ESP_PLATFORM */
+#include <stdint.h>
 
 #include "linux_macros.h"
 
@@ -303,30 +301,24 @@ static inline void hlist_move_list(struct hlist_head *old,
 #define hash_min(val, bits)							\
 	(sizeof(val) <= 4 ? hash_32(val, bits) : hash_long(val, bits))
 */
+#define FNV1A_32_OFFSET     2166136261u
+#define FNV1A_32_PRIME      16777619u
+
+/* FNV-1a of a string, a few cycles per byte, not for untrusted keys */
+static inline uint32_t hash_fnv1a(const char *val)
+{
+    uint32_t h = FNV1A_32_OFFSET;
+    for (const unsigned char *p = (const unsigned char *)val; '\0' != *p; p++) {
+        h ^= *p;
+        h *= FNV1A_32_PRIME;
+    }
+    return h;
+}
+
+/* bucket of a string key in a table of 1 << bits, high bits mixed best by FNV */
 static inline unsigned int hash_min(const char *val, size_t bits)
 {
-    #if defined(__linux__) || defined(__linux)
-
-    #elif defined(CONFIG_FreeRTOS)
-    mbedtls_md5_context ctx;
-    unsigned char decrypt[16];
-
-    mbedtls_md5_init(&ctx);
-    mbedtls_md5_starts(&ctx);
-    mbedtls_md5_update(&ctx, (unsigned char *)val, strlen(val));
-    mbedtls_md5_finish(&ctx, decrypt);
-    mbedtls_md5_free(&ctx);
-    KRNL_DEBUG("%s md5 is:[", val);
-    for (int i = 0; i < 16; i++)
-        KRNL_DEBUG("%02x", decrypt[i]);
-    KRNL_DEBUG("]\n");
-
-    uint32_t digest = (decrypt[3] << 24 | decrypt[2] << 16 \
-                        | decrypt[1] << 8 | decrypt[0]) >> (32 - bits);
-    KRNL_DEBUG("%s md5 digest is:<%lx>", val, digest);
-    #endif /* _ESP_PLATFORM */
-
-    return digest;
+    return 0 == bits ? 0 : hash_fnv1a(val) >> (32 - bits);
 }
 
 static inline void __hash_init(struct hlist_head *ht, unsigned int sz)
@@ -17,7 +17,11 @@
 
 #define INNER_RES_OK                0
 
+#ifdef KRNL_NO_DEBUG
+#define KRNL_DEBUG(...) do {} while(0)     // e.g. for benchmarks on host
+#else
 #define KRNL_DEBUG(...) do {fprintf(stderr, __VA_ARGS__);} while(0)
+#endif /* KRNL_NO_DEBUG */
 #define KRNL_INFO(...) do {fprintf(stderr, __VA_ARGS__);} while(0)
 #define KRNL_WARN(...) do {fprintf(stderr, __VA_ARGS__);} while(0)
 #define KRNL_ERROR(...) do {fprintf(stderr, __VA_ARGS__);} while(0)
@@ -103,9 +107,24 @@
 
 #define NO_MORE_THAN(val, limit) ((val) > (limit) ? (limit) : (val))
 
+/*
+ * fill blocks with a pattern on malloc and free in debug build,
+ * to catch reads of data never written or already released
+ */
+#ifndef BLK_POISON_BYTE
+#define BLK_POISON_BYTE     0xA5
+#endif /* BLK_POISON_BYTE */
+
+#if defined(BLK_POISON) || defined(CONFIG_BLK_POISON)
+#define blk_poison(ptr, n)  memset((ptr), BLK_POISON_BYTE, (n))
+#else
+#define blk_poison(ptr, n)  do {} while (0)
+#endif /* BLK_POISON */
+
 #if defined(__linux__) || defined(__linux)
 #include <stdlib.h>
 #include <sys/time.h>
+#include <unistd.h>
 
 #define delay_ms(ms)    usleep((ms)*1000)
 
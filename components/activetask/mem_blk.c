@@ -11,6 +11,7 @@
 #include <string.h>
 
 #include "linux_llist.h"
+#include "lf_stack.h"
 #include "linux_macros.h"
 
 #include "mem_blk.h"
@@ -19,7 +20,8 @@ struct _memblk {
     int _capacity;
     int _size;
     bool _valid;
-    struct llist_node _node;
+    unsigned long _alloc_ms;
+    lf_node _node;
     char data[0];
 };
 
@@ -29,7 +31,7 @@ struct _memblk {
     ._capacity = cap, \
     ._size = size,\
     ._valid = false, \
-    ._node = {NULL}, \
+    ._node = {{NULL}, 0, 0}, \
 }
 
 #define MEMBLK_SIZE(arg)    ((container_of((arg), struct _memblk, data))->_size)
@@ -37,7 +39,9 @@ struct _memblk {
 #define MEMBLK_CAP(arg)    ((container_of((arg), struct _memblk, data))->_capacity)
 
 struct _memblk_pool {
-    struct llist_head mem_stack[MEMBLK_STACK_NUM];
+    lf_stack          mem_stack[MEMBLK_STACK_NUM];
+    int                 blk_num[MEMBLK_STACK_NUM];
+    blk_counter           stats[MEMBLK_STACK_NUM];
 };
 
 #define MEMBLK_STACK_INDEX(blk) ((int)(((blk)->_capacity-1)/MEMBLK_MIN_SIZE) < MEMBLK_STACK_NUM \
@@ -46,7 +50,7 @@ struct _memblk_pool {
 static struct _memblk_pool g_memblk_pool;
 
 /***
- * @description : malloc a memory block
+ * @description : malloc a memory block, content not cleared
  * @param        {int} size - size of memory block
  * @return       {*} pointer to data buffer
  */
@@ -58,26 +62,44 @@ void *memblk_malloc(int size)
     if (-1 == stack_index) return NULL;
 
     // find possible stack
+    int fit_index = stack_index;
     for (; stack_index < MEMBLK_STACK_NUM; stack_index++) {
-        if (!llist_empty(&g_memblk_pool.mem_stack[stack_index])) break;
+        if (!lf_stack_empty(&g_memblk_pool.mem_stack[stack_index])) break;
     }
     KRNL_DEBUG("malloc size %d, serached stack %d\n", size, stack_index);
-    if (MEMBLK_STACK_NUM <= stack_index) return NULL;
-
-    struct llist_node *node = llist_del_first(
-                &g_memblk_pool.mem_stack[stack_index]);
-    if (NULL == node) return NULL;
+    struct llist_node *node = NULL;
+    if (MEMBLK_STACK_NUM > stack_index)
+        node = lf_stack_pop(&g_memblk_pool.mem_stack[stack_index]);
+    if (NULL == node) {
+        blk_counter_fail(&g_memblk_pool.stats[fit_index]);
+        return NULL;
+    }
+    if (fit_index != stack_index) blk_counter_fallback(&g_memblk_pool.stats[fit_index]);
+    blk_counter_alloc(&g_memblk_pool.stats[stack_index]);
     struct _memblk *blk = container_of(node, struct _memblk, _node);
+    blk->_alloc_ms = get_sys_ms();
     KRNL_DEBUG("malloc size %d, serached stack %d, node %p, data %p, blk %p, cap %d\n",
             size, stack_index, node, blk->data, blk, blk->_capacity);
     blk->_size = size;
     blk->_valid = false;
-    memset(blk->data, 0, blk->_capacity);
+    blk_poison(blk->data, blk->_capacity);
     KRNL_DEBUG("===malloc size %d, serached stack %d, node %p, data %p, blk %p, cap %d\n",
             size, stack_index, node, blk->data, blk, blk->_capacity);
     return blk->data;
 }
 
+/***
+ * @description : malloc a memory block with size bytes cleared
+ * @param        {int} size - size of memory block
+ * @return       {*} pointer to data buffer
+ */
+void *memblk_calloc(int size)
+{
+    void *data = memblk_malloc(size);
+    if (NULL != data) memset(data, 0, size);
+    return data;
+}
+
 /***
  * @description : recyle a memory block
  * @param        {void} *arg - pointer to memory block
@@ -90,9 +112,11 @@ void memblk_free(void *arg)
 
     KRNL_DEBUG("free size %d, stack %d, node %p, data %p, blk %p, cap %d\n",
             blk->_size, MEMBLK_STACK_INDEX(blk), &blk->_node, arg, blk, blk->_capacity);
+    blk_counter_free(&g_memblk_pool.stats[MEMBLK_STACK_INDEX(blk)], get_sys_ms() - blk->_alloc_ms);
+    blk_poison(blk->data, blk->_capacity);
     blk->_size = 0;
     blk->_valid = false;
-    llist_add(&blk->_node, &g_memblk_pool.mem_stack[MEMBLK_STACK_INDEX(blk)]);
+    lf_stack_push(&g_memblk_pool.mem_stack[MEMBLK_STACK_INDEX(blk)], &blk->_node.node);
 }
 
 /***
@@ -125,7 +149,7 @@ at_error_t memblk_pool_init(void)
 {
     memset(&g_memblk_pool, 0, sizeof(g_memblk_pool));
     for (int i = 0; i < MEMBLK_STACK_NUM; i++) {
-        g_memblk_pool.mem_stack[i].first = NULL;
+        lf_stack_init(&g_memblk_pool.mem_stack[i]);
         int blk_num = NO_LESS_THAN(MEMBLK_NUM >> i, 2);     // decrease blk num to half
         int blk_cap = MEMBLK_MIN_SIZE * (i + 1);
         struct _memblk *blk = NULL;
@@ -135,7 +159,12 @@ at_error_t memblk_pool_init(void)
             blk->_capacity = blk_cap;
             blk->_size = 0;
             blk->_valid = false;
-            llist_add(&blk->_node, &g_memblk_pool.mem_stack[i]);
+            if (!lf_node_register(&blk->_node)) {
+                free(blk);
+                return MEMORY_MALLOC_FAILED;
+            }
+            lf_stack_push(&g_memblk_pool.mem_stack[i], &blk->_node.node);
+            g_memblk_pool.blk_num[i]++;
         }
     }
     return INNER_RES_OK;
@@ -149,9 +178,41 @@ void memblk_pool_fini(void)
 {
     for (int i = 0; i < MEMBLK_STACK_NUM; i++) {
         struct llist_node *node = NULL;
-        while (NULL != (node = llist_del_first(&g_memblk_pool.mem_stack[i]))) {
+        while (NULL != (node = lf_stack_pop(&g_memblk_pool.mem_stack[i]))) {
             struct _memblk *blk = container_of(node, struct _memblk, _node);
+            lf_node_unregister(&blk->_node);
             free(blk);
         }
     }
 }
+
+/***
+ * @description : get usage of a memory block stack
+ * @param        {int} index - stack index
+ * @param        {blk_stats} *stats - usage got
+ * @return       {*}
+ */
+at_error_t memblk_pool_stats(int index, blk_stats *stats)
+{
+    if (0 > index || MEMBLK_STACK_NUM <= index || NULL == stats) return INNER_INVAILD_PARAM;
+    memset(stats, 0, sizeof(blk_stats));
+    blk_counter_read(&g_memblk_pool.stats[index], stats);
+    stats->capacity = MEMBLK_MIN_SIZE * (index + 1);
+    stats->blk_num = g_memblk_pool.blk_num[index];
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : log usage of each memory block stack
+ * @return       {*}
+ */
+void memblk_pool_dump(void)
+{
+    blk_stats stats;
+    for (int i = 0; i < MEMBLK_STACK_NUM; i++) {
+        memblk_pool_stats(i, &stats);
+        KRNL_INFO("memory block stack %d: cap %d, used %d/%d, peak %d, fail %u, fallback %u, "
+                "hold %u ms\n", i, stats.capacity, stats.used_num, stats.blk_num,
+                stats.peak_num, stats.fail_num, stats.fallback_num, stats.avg_hold_ms);
+    }
+}
@@ -15,6 +15,7 @@
 #include <stdbool.h>
 
 #include "inner_err.h"
+#include "blk_stats.h"
 
 #ifndef MEMBLK_MIN_SIZE
 #define MEMBLK_MIN_SIZE    8
@@ -33,12 +34,19 @@ extern "C" {
 #endif
 
 /***
- * @description : malloc a memory block
+ * @description : malloc a memory block, content not cleared
  * @param        {int} size - size of memory block
  * @return       {*} pointer to data buffer
  */
 void *memblk_malloc(int size);
 
+/***
+ * @description : malloc a memory block with size bytes cleared
+ * @param        {int} size - size of memory block
+ * @return       {*} pointer to data buffer
+ */
+void *memblk_calloc(int size);
+
 /***
  * @description : recyle a memory block
  * @param        {void} *arg - pointer to memory block
@@ -72,6 +80,20 @@ at_error_t memblk_pool_init(void);
  */
 void memblk_pool_fini(void);
 
+/***
+ * @description : get usage of a memory block stack
+ * @param        {int} index - stack index
+ * @param        {blk_stats} *stats - usage got
+ * @return       {*}
+ */
+at_error_t memblk_pool_stats(int index, blk_stats *stats);
+
+/***
+ * @description : log usage of each memory block stack
+ * @return       {*}
+ */
+void memblk_pool_dump(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,19 +10,30 @@
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
 
 #include "linux_llist.h"
+#include "lf_stack.h"
 #include "linux_macros.h"
 #include "inner_err.h"
 #include "linux_refcount.h"
+#include "blk_magazine.h"
+#include "blk_track.h"
 
 #include "msg_blk.h"
 
 struct _inner_msgblk {
     bool                        _valid;
-    struct llist_node            _node;
+    lf_node                      _node;
     struct kref               refcount;     // reference counter
+    atomic_int                  _holds;     // msg block and inline data block
+    unsigned long            _alloc_ms;     // time of malloc
+#ifdef BLK_TRACK
+    blk_track                   _track;     // malloc site while in use
+#endif /* BLK_TRACK */
     msgblk                       _mblk;
+    uintptr_t                _inline[];     // inline data block, if any
 };
 
 #define SIZE_INNER_MSGBLK_HEAD    sizeof(struct _inner_msgblk)
@@ -35,11 +46,18 @@ struct _msgblk_pool {
     on_datablk_attach          _attach;
     on_datablk_dettach        _dettach;
     void                         *_arg;
-    struct llist_head        msg_stack;
+    lf_stack                 msg_stack;     // depot
+    int                        mag_cap;     // magazine capacity
+    int                    inline_size;     // memory for inline data block
+    int                        blk_num;
+    blk_counter                  stats;
 };
 
 static struct _msgblk_pool g_msgblk_pool;
 
+static __thread blk_magazine t_msgblk_mag;
+static __thread blk_counter_local t_msgblk_cnt;
+
 /***
  * @description : init msg block pool
  * @param        {on_msgblk_init} init_func - callback function after msg block malloc
@@ -53,18 +71,26 @@ at_error_t msgblk_pool_init(on_msgblk_init init_func, on_msgblk_fini fini_func,
         on_datablk_attach attch_func, on_datablk_dettach dettach_func, void *arg)
 {
     memset(&g_msgblk_pool, 0, sizeof(g_msgblk_pool));
-    g_msgblk_pool.msg_stack.first = NULL;
+    if (INNER_RES_OK != blk_track_init()) return MEMORY_MALLOC_FAILED;
+    lf_stack_init(&g_msgblk_pool.msg_stack);
     int blk_num = NO_LESS_THAN(MSGBLK_NUM, 2);
+    g_msgblk_pool.inline_size = 0 < MSGBLK_INLINE_SIZE ? datablk_embed_size(MSGBLK_INLINE_SIZE) : 0;
     struct _inner_msgblk *blk = NULL;
     for (int j = 0; j < blk_num; j++) {
-        blk = (struct _inner_msgblk *)malloc(SIZE_INNER_MSGBLK_HEAD);
+        blk = (struct _inner_msgblk *)malloc(SIZE_INNER_MSGBLK_HEAD + g_msgblk_pool.inline_size);
         if (NULL == blk) return MEMORY_MALLOC_FAILED;
         blk->_valid = false;
         kref_init(&blk->refcount);
         blk->_mblk.msg_type = -1;
         INIT_LIST_HEAD(&blk->_mblk.list_datablk);
-        llist_add(&blk->_node, &g_msgblk_pool.msg_stack);
+        if (!lf_node_register(&blk->_node)) {
+            free(blk);
+            return MEMORY_MALLOC_FAILED;
+        }
+        lf_stack_push(&g_msgblk_pool.msg_stack, &blk->_node.node);
+        g_msgblk_pool.blk_num++;
     }
+    g_msgblk_pool.mag_cap = blk_mag_cap(blk_num);     // pool never grows
     g_msgblk_pool._init = init_func;
     g_msgblk_pool._fini = fini_func;
     g_msgblk_pool._attach = attch_func;
@@ -80,45 +106,117 @@ at_error_t msgblk_pool_init(on_msgblk_init init_func, on_msgblk_fini fini_func,
  */
 void msgblk_pool_fini(void)
 {
+    msgblk_thread_flush();
     struct llist_node *node = NULL;
-    while (NULL != (node = llist_del_first(&g_msgblk_pool.msg_stack))) {
+    while (NULL != (node = lf_stack_pop(&g_msgblk_pool.msg_stack))) {
         struct _inner_msgblk *blk = container_of(node, struct _inner_msgblk, _node);
+        lf_node_unregister(&blk->_node);
         free(blk);
     }
     KRNL_DEBUG("msg block pool fini\n");
 }
 
-/***
- * @description : malloc msg block with a data block attached
- * @param        {msgblk} *db - pointer to data block attached
- * @return       {*} - pointer to msg block, got NULL if failed
- */
-msgblk * msgblk_malloc(datablk *db)
+/* get a msg block from pool, without data block, site for tracking */
+static struct _inner_msgblk *msgblk_alloc(const void *site)
 {
-    struct llist_node *node = llist_del_first(&g_msgblk_pool.msg_stack);
-    if (NULL == node) return NULL;
+    struct llist_node *node = blk_mag_alloc(&t_msgblk_mag, g_msgblk_pool.mag_cap,
+            &g_msgblk_pool.msg_stack);
+    if (NULL == node) {
+        blk_counter_fail(&g_msgblk_pool.stats);
+        return NULL;
+    }
+    blk_counter_local_alloc(&g_msgblk_pool.stats, &t_msgblk_cnt, 0);
     struct _inner_msgblk *blk = container_of(node, struct _inner_msgblk, _node);
-    KRNL_DEBUG("malloc node %p, msg %p, blk %p, data %p\n",
-            node, &blk->_mblk, blk, db);
+    blk->_alloc_ms = get_sys_ms();
+    KRNL_DEBUG("malloc node %p, msg %p, blk %p\n", node, &blk->_mblk, blk);
     blk->_valid = false;
     INIT_LIST_HEAD(&blk->_mblk.list_datablk);
     blk->_mblk.msg_type = -1;
     kref_init(&blk->refcount);  // reset reference to 1
+    atomic_store_explicit(&blk->_holds, 1, memory_order_relaxed);
+    blk_track_add(&blk->_track, "msgblk", &blk->_mblk, site);
     if (NULL != g_msgblk_pool._init)
         if (INNER_RES_OK != g_msgblk_pool._init(&blk->_mblk, g_msgblk_pool._arg)) {
             msgblk_free(&blk->_mblk);
             return NULL;
         }
+    return blk;
+}
 
+/* recycle msg block when both itself and inline data block unused */
+static void msgblk_put(struct _inner_msgblk *blk)
+{
+    if (1 != atomic_fetch_sub_explicit(&blk->_holds, 1, memory_order_acq_rel)) return;
+    blk_counter_local_free(&g_msgblk_pool.stats, &t_msgblk_cnt, 0, get_sys_ms() - blk->_alloc_ms);
+    blk_mag_free(&t_msgblk_mag, g_msgblk_pool.mag_cap, &blk->_node.node, &g_msgblk_pool.msg_stack);
+}
+
+/* inline data block released, maybe after the msg block */
+static void msgblk_inline_release(datablk *db, void *arg)
+{
+    msgblk_put(container_of(arg, struct _inner_msgblk, _inline));
+}
+
+/* msgblk_malloc tracked at site */
+static msgblk *msgblk_malloc_at(datablk *db, const void *site)
+{
+    struct _inner_msgblk *blk = msgblk_alloc(site);
+    if (NULL == blk) return NULL;
+    KRNL_DEBUG("malloc msg %p, data %p\n", &blk->_mblk, db);
     msgblk_attach_datablk(&blk->_mblk, db);
     return &blk->_mblk;
 }
 
+/***
+ * @description : malloc msg block with a data block attached
+ * @param        {msgblk} *db - pointer to data block attached
+ * @return       {*} - pointer to msg block, got NULL if failed
+ */
+msgblk * msgblk_malloc(datablk *db)
+{
+    return msgblk_malloc_at(db, BLK_CALLER());
+}
+
+/***
+ * @description : malloc msg block with a data block of size bytes, inline in
+ *                  the msg block if no more than MSGBLK_INLINE_SIZE
+ * @param        {int} size - desired size of data block
+ * @return       {*} - pointer to msg block, got NULL if failed
+ */
+msgblk *msgblk_malloc_inline(int size)
+{
+    if (0 > size) return NULL;
+    const void *site = BLK_CALLER();
+    if (0 == MSGBLK_INLINE_SIZE || size > MSGBLK_INLINE_SIZE) {
+        // no inline area in msg blocks, or too small, both tracked at caller
+        datablk *db = datablk_malloc_at(size, site);
+        if (NULL == db) return NULL;
+        msgblk *mb = msgblk_malloc_at(db, site);
+        datablk_free(db);   // held by msg block
+        if (NULL != mb) blk_counter_fallback(&g_msgblk_pool.stats);
+        return mb;
+    }
+
+    struct _inner_msgblk *blk = msgblk_alloc(site);
+    if (NULL == blk) return NULL;
+    datablk *db = datablk_embed(blk->_inline, MSGBLK_INLINE_SIZE, size, msgblk_inline_release);
+    atomic_fetch_add_explicit(&blk->_holds, 1, memory_order_relaxed);
+    at_error_t res = msgblk_attach_datablk(&blk->_mblk, db);
+    datablk_free(db);       // held by msg block
+    if (INNER_RES_OK != res) {
+        msgblk_free(&blk->_mblk);
+        return NULL;
+    }
+    KRNL_DEBUG("malloc msg %p, inline data %p\n", &blk->_mblk, db);
+    return &blk->_mblk;
+}
+
 static void __msgblk_release(struct kref *ref)
 {
     struct _inner_msgblk *blk = container_of(ref, struct _inner_msgblk, refcount);
     if (NULL != g_msgblk_pool._fini)
         g_msgblk_pool._fini(&blk->_mblk, g_msgblk_pool._arg);
+    blk_track_del(&blk->_track);
 
     KRNL_DEBUG("free node %p, msg %p, blk %p\n",
             &blk->_node, &blk->_mblk, blk);
@@ -133,7 +231,18 @@ static void __msgblk_release(struct kref *ref)
         }
     }
     INIT_LIST_HEAD(&blk->_mblk.list_datablk);
-    llist_add(&blk->_node, &g_msgblk_pool.msg_stack);
+    msgblk_put(blk);
+}
+
+/***
+ * @description : return msg blocks cached by current thread to pool and
+ *                  fold its usage counters, call before a thread using msg blocks ends
+ * @return       {*}
+ */
+void msgblk_thread_flush(void)
+{
+    blk_mag_flush(&t_msgblk_mag, &g_msgblk_pool.msg_stack);
+    blk_counter_fold(&g_msgblk_pool.stats, &t_msgblk_cnt);
 }
 
 /***
@@ -147,6 +256,12 @@ void msgblk_free(msgblk *mb)
     if (NULL == mb) return;
 
     struct _inner_msgblk *blk = container_of(mb, struct _inner_msgblk, _mblk);
+#ifdef BLK_TRACK
+    if (0 == kref_read(&blk->refcount)) {
+        blk_track_double_free(&blk->_track, mb, BLK_CALLER());
+        return;
+    }
+#endif /* BLK_TRACK */
     // decrease reference, if 0 recycle with fini
     kref_put(&blk->refcount, __msgblk_release);  // decrease reference
 }
@@ -239,7 +354,9 @@ at_error_t msgblk_push_circ_queue(circ_queue *queue, msgblk *mb, int wait_ms)
 {
     if (NULL == queue || NULL == mb) return INNER_INVAILD_PARAM;
     msgblk_ref(mb);
-    return queue->queue_push(queue, (void *)mb, wait_ms);
+    at_error_t res = queue->queue_push(queue, (void *)mb, wait_ms);
+    if (INNER_RES_OK != res) msgblk_free(mb);   // reference for queue
+    return res;
 }
 
 /***
@@ -255,6 +372,68 @@ at_error_t msgblk_pop_circ_queue(circ_queue *queue, msgblk **pmb, int wait_ms)
     return queue->queue_pop(queue, (void **)pmb, wait_ms);
 }
 
+/***
+ * @description : push msg blocks in a circular queue with one reservation
+ * @param        {circ_queue} *queue - pointer to queue
+ * @param        {msgblk} **mbs - array of msg block pointers
+ * @param        {int} *num - in: number to push, out: number pushed
+ * @param        {int} wait_ms - wait time in ms
+ * @return       {*}
+ */
+at_error_t msgblk_push_circ_queue_n(circ_queue *queue, msgblk **mbs, int *num, int wait_ms)
+{
+    if (NULL == queue || NULL == mbs || NULL == num) return INNER_INVAILD_PARAM;
+    int total = *num;
+    for (int i = 0; i < total; i++) msgblk_ref(mbs[i]);
+    at_error_t res = queue->queue_push_n(queue, (void **)mbs, num, wait_ms);
+    // references for the ones left out
+    for (int i = *num; i < total; i++) msgblk_free(mbs[i]);
+    return res;
+}
+
+/***
+ * @description : pop msg blocks from a circular queue with one reservation
+ * @param        {circ_queue} *queue - pointer to queue
+ * @param        {msgblk} **pmbs - array of msg block pointers
+ * @param        {int} *num - in: max number to pop, out: number popped
+ * @param        {int} wait_ms - wait time in ms
+ * @return       {*}
+ */
+at_error_t msgblk_pop_circ_queue_n(circ_queue *queue, msgblk **pmbs, int *num, int wait_ms)
+{
+    if (NULL == queue || NULL == pmbs || NULL == num) return INNER_INVAILD_PARAM;
+    return queue->queue_pop_n(queue, (void **)pmbs, num, wait_ms);
+}
+
+/***
+ * @description : get usage of msg block pool, fallback_num counts inline
+ *                  malloc with data block from data block pool
+ * @param        {blk_stats} *stats - usage got
+ * @return       {*}
+ */
+at_error_t msgblk_pool_stats(blk_stats *stats)
+{
+    if (NULL == stats) return INNER_INVAILD_PARAM;
+    memset(stats, 0, sizeof(blk_stats));
+    blk_counter_read(&g_msgblk_pool.stats, stats);
+    stats->capacity = MSGBLK_INLINE_SIZE;
+    stats->blk_num = g_msgblk_pool.blk_num;
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : log usage of msg block pool
+ * @return       {*}
+ */
+void msgblk_pool_dump(void)
+{
+    blk_stats stats;
+    msgblk_pool_stats(&stats);
+    KRNL_INFO("msg block: inline %d, used %d/%d, peak %d, fail %u, fallback %u, hold %u ms\n",
+            stats.capacity, stats.used_num, stats.blk_num, stats.peak_num,
+            stats.fail_num, stats.fallback_num, stats.avg_hold_ms);
+}
+
 /***
  * @description : get first data block from message block
  * @param        {msgblk} *mb - pointer to message block
@@ -267,4 +446,52 @@ datablk *msgblk_first_datablk(msgblk *mb)
     if (list_empty(&mb->list_datablk)) return NULL;
 
     return list_first_entry(&mb->list_datablk, datablk, node_msgdata);
-}
\ No newline at end of file
+}
+/***
+ * @description : get total length of data in all data blocks
+ * @param        {msgblk} *mb - pointer to message block
+ * @return       {*}
+ */
+int msgblk_length(msgblk *mb)
+{
+    if (NULL == mb) return 0;
+
+    int len = 0;
+    datablk *db;
+    msgblk_for_each_datablk(db, mb) len += datablk_length(db);
+    return len;
+}
+
+/***
+ * @description : get data of all data blocks in one data block, copied only if
+ *                  more than one block has data, free the result after use
+ * @param        {msgblk} *mb - pointer to message block
+ * @return       {*} - pointer to data block, got NULL if empty or failed
+ */
+datablk *msgblk_linearize(msgblk *mb)
+{
+    if (NULL == mb) return NULL;
+
+    datablk *db, *only = NULL;
+    int parts = 0;
+    msgblk_for_each_datablk(db, mb) {
+        if (0 == datablk_length(db)) continue;
+        only = db;
+        parts++;
+    }
+    if (0 == parts) return NULL;
+    if (1 == parts) {
+        datablk_ref(only);  // already in one piece
+        return only;
+    }
+
+    datablk *linear = datablk_malloc(msgblk_length(mb));
+    if (NULL == linear) return NULL;
+    linear->data_type = msgblk_first_datablk(mb)->data_type;
+    msgblk_for_each_datablk(db, mb) {
+        int len = datablk_length(db);
+        memcpy(linear->wr_ptr, db->rd_ptr, len);
+        datablk_move_wr(linear, len);
+    }
+    return linear;
+}
@@ -17,9 +17,24 @@
 #include "data_blk.h"
 
 #ifndef MSGBLK_NUM
+#ifdef CONFIG_MSG_BLK_NUM
+#define MSGBLK_NUM     CONFIG_MSG_BLK_NUM
+#else
 #define MSGBLK_NUM     8
+#endif /* CONFIG_MSG_BLK_NUM */
 #endif /* MSGBLK_NUM */
 
+/*
+ * bytes of data block inline in each msg block, 0 to disable
+ */
+#ifndef MSGBLK_INLINE_SIZE
+#ifdef CONFIG_MSG_BLK_INLINE
+#define MSGBLK_INLINE_SIZE     CONFIG_MSG_BLK_INLINE
+#else
+#define MSGBLK_INLINE_SIZE     48
+#endif /* CONFIG_MSG_BLK_INLINE */
+#endif /* MSGBLK_INLINE_SIZE */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -33,6 +48,12 @@ struct msgblk_t {
 
 typedef struct msgblk_t msgblk;
 
+/*
+ * iterate data blocks of a message block in order
+ */
+#define msgblk_for_each_datablk(pos, mb) \
+    list_for_each_entry(pos, &(mb)->list_datablk, node_msgdata)
+
 /***
  * @description : callback function after msgblk malloc success
  * @param        {msgblk} *mb - pointer to msg block
@@ -85,6 +106,15 @@ at_error_t msgblk_pool_init(on_msgblk_init init_func, on_msgblk_fini fini_func,
  */
 void msgblk_pool_fini(void);
 
+/***
+ * @description : return msg blocks cached by current thread to pool and
+ *                  fold its usage counters, done when an active task ends,
+ *                  other threads using msg blocks call it before they end,
+ *                  or now and then if never ending, e.g. event handlers
+ * @return       {*}
+ */
+void msgblk_thread_flush(void);
+
 /***
  * @description : malloc msg block with a data block attached
  * @param        {msgblk} *db - pointer to data block attached
@@ -92,6 +122,14 @@ void msgblk_pool_fini(void);
  */
 msgblk * msgblk_malloc(datablk *db);
 
+/***
+ * @description : malloc msg block with a data block of size bytes, inline in
+ *                  the msg block if no more than MSGBLK_INLINE_SIZE
+ * @param        {int} size - desired size of data block
+ * @return       {*} - pointer to msg block, got NULL if failed
+ */
+msgblk *msgblk_malloc_inline(int size);
+
 /***
  * @description : clear msg block, decrease reference
  *                  msg block would be release if reference = 0
@@ -155,6 +193,40 @@ at_error_t msgblk_push_circ_queue(circ_queue *queue, msgblk *mb, int wait_ms);
  */
 at_error_t msgblk_pop_circ_queue(circ_queue *queue, msgblk **pmb, int wait_ms);
 
+/***
+ * @description : push msg blocks in a circular queue with one reservation
+ * @param        {circ_queue} *queue - pointer to queue
+ * @param        {msgblk} **mbs - array of msg block pointers
+ * @param        {int} *num - in: number to push, out: number pushed
+ * @param        {int} wait_ms - wait time in ms
+ * @return       {*}
+ */
+at_error_t msgblk_push_circ_queue_n(circ_queue *queue, msgblk **mbs, int *num, int wait_ms);
+
+/***
+ * @description : pop msg blocks from a circular queue with one reservation
+ * @param        {circ_queue} *queue - pointer to queue
+ * @param        {msgblk} **pmbs - array of msg block pointers
+ * @param        {int} *num - in: max number to pop, out: number popped
+ * @param        {int} wait_ms - wait time in ms
+ * @return       {*}
+ */
+at_error_t msgblk_pop_circ_queue_n(circ_queue *queue, msgblk **pmbs, int *num, int wait_ms);
+
+/***
+ * @description : get usage of msg block pool, fallback_num counts inline
+ *                  malloc with data block from data block pool
+ * @param        {blk_stats} *stats - usage got
+ * @return       {*}
+ */
+at_error_t msgblk_pool_stats(blk_stats *stats);
+
+/***
+ * @description : log usage of msg block pool
+ * @return       {*}
+ */
+void msgblk_pool_dump(void);
+
 /***
  * @description : get first data block from message block
  * @param        {msgblk} *mb - pointer to message block
@@ -162,6 +234,21 @@ at_error_t msgblk_pop_circ_queue(circ_queue *queue, msgblk **pmb, int wait_ms);
  */
 datablk *msgblk_first_datablk(msgblk *mb);
 
+/***
+ * @description : get total length of data in all data blocks
+ * @param        {msgblk} *mb - pointer to message block
+ * @return       {*}
+ */
+int msgblk_length(msgblk *mb);
+
+/***
+ * @description : get data of all data blocks in one data block, copied only if
+ *                  more than one block has data, free the result after use
+ * @param        {msgblk} *mb - pointer to message block
+ * @return       {*} - pointer to data block, got NULL if empty or failed
+ */
+datablk *msgblk_linearize(msgblk *mb);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,211 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 09:13:02
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 09:13:02
+ * @FilePath    : /activetask/components/activetask/os_sync.c
+ * @Description :
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__linux__) || defined(__linux)
+#include <time.h>
+#include <errno.h>
+#endif /* __linux__ */
+
+#include "linux_macros.h"
+#include "os_sync.h"
+
+/***
+ * @description : init a mutex
+ * @param        {os_mutex} *mtx - pointer to mutex
+ * @return       {*}
+ */
+at_error_t os_mutex_init(os_mutex *mtx)
+{
+    if (NULL == mtx) return INNER_INVAILD_PARAM;
+#if defined(__linux__) || defined(__linux)
+    if (0 != pthread_mutex_init(&mtx->mutex, NULL)) return MEMORY_MALLOC_FAILED;
+#elif defined(CONFIG_FreeRTOS)
+    mtx->mutex = xSemaphoreCreateMutex();
+    if (NULL == mtx->mutex) return MEMORY_MALLOC_FAILED;
+#endif /* _ESP_PLATFORM */
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : clear a mutex
+ * @param        {os_mutex} *mtx - pointer to mutex
+ * @return       {*}
+ */
+void os_mutex_fini(os_mutex *mtx)
+{
+    if (NULL == mtx) return;
+#if defined(__linux__) || defined(__linux)
+    pthread_mutex_destroy(&mtx->mutex);
+#elif defined(CONFIG_FreeRTOS)
+    if (NULL != mtx->mutex) vSemaphoreDelete(mtx->mutex);
+    mtx->mutex = NULL;
+#endif /* _ESP_PLATFORM */
+}
+
+/***
+ * @description : lock a mutex, wait forever
+ * @param        {os_mutex} *mtx - pointer to mutex
+ * @return       {*}
+ */
+void os_mutex_lock(os_mutex *mtx)
+{
+#if defined(__linux__) || defined(__linux)
+    pthread_mutex_lock(&mtx->mutex);
+#elif defined(CONFIG_FreeRTOS)
+    xSemaphoreTake(mtx->mutex, portMAX_DELAY);
+#endif /* _ESP_PLATFORM */
+}
+
+/***
+ * @description : unlock a mutex
+ * @param        {os_mutex} *mtx - pointer to mutex
+ * @return       {*}
+ */
+void os_mutex_unlock(os_mutex *mtx)
+{
+#if defined(__linux__) || defined(__linux)
+    pthread_mutex_unlock(&mtx->mutex);
+#elif defined(CONFIG_FreeRTOS)
+    xSemaphoreGive(mtx->mutex);
+#endif /* _ESP_PLATFORM */
+}
+
+/***
+ * @description : init an event
+ * @param        {os_event} *ev - pointer to event
+ * @return       {*}
+ */
+at_error_t os_event_init(os_event *ev)
+{
+    if (NULL == ev) return INNER_INVAILD_PARAM;
+    atomic_init(&ev->waiters, 0);
+#if defined(__linux__) || defined(__linux)
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&ev->lock, NULL);
+    int res = pthread_cond_init(&ev->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (0 != res) {
+        pthread_mutex_destroy(&ev->lock);
+        return MEMORY_MALLOC_FAILED;
+    }
+#elif defined(CONFIG_FreeRTOS)
+    ev->sem = xSemaphoreCreateCounting(OS_EVENT_MAX_COUNT, 0);
+    if (NULL == ev->sem) return MEMORY_MALLOC_FAILED;
+#endif /* _ESP_PLATFORM */
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : clear an event, no waiter is allowed
+ * @param        {os_event} *ev - pointer to event
+ * @return       {*}
+ */
+void os_event_fini(os_event *ev)
+{
+    if (NULL == ev) return;
+#if defined(__linux__) || defined(__linux)
+    pthread_cond_destroy(&ev->cond);
+    pthread_mutex_destroy(&ev->lock);
+#elif defined(CONFIG_FreeRTOS)
+    if (NULL != ev->sem) vSemaphoreDelete(ev->sem);
+    ev->sem = NULL;
+#endif /* _ESP_PLATFORM */
+}
+
+/***
+ * @description : register as a waiter, must be followed by wait or cancel
+ * @param        {os_event} *ev - pointer to event
+ * @return       {*}
+ */
+void os_event_prepare(os_event *ev)
+{
+#if defined(__linux__) || defined(__linux)
+    // hold the lock until wait/cancel, a notifier seeing waiters > 0 has to
+    // take the lock and so can't signal before the waiter is really waiting
+    pthread_mutex_lock(&ev->lock);
+#endif /* __linux__ */
+    atomic_fetch_add(&ev->waiters, 1);
+    // pairs with fence in notify: either the waiter's re-check of condition
+    // sees the peer's change, or the peer sees waiters > 0
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+/***
+ * @description : unregister a waiter prepared, when condition became true
+ * @param        {os_event} *ev - pointer to event
+ * @return       {*}
+ */
+void os_event_cancel(os_event *ev)
+{
+    atomic_fetch_sub(&ev->waiters, 1);
+#if defined(__linux__) || defined(__linux)
+    pthread_mutex_unlock(&ev->lock);
+#endif /* __linux__ */
+}
+
+/***
+ * @description : block until notified or timeout, spurious wakeup is possible
+ * @param        {os_event} *ev - pointer to event
+ * @param        {int} wait_ms - wait time in ms, 0 means forever
+ * @return       {*} - false if timeout
+ */
+bool os_event_wait(os_event *ev, int wait_ms)
+{
+    bool notified = true;
+#if defined(__linux__) || defined(__linux)
+    if (0 >= wait_ms) {
+        pthread_cond_wait(&ev->cond, &ev->lock);
+    } else {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_sec += wait_ms / 1000;
+        ts.tv_nsec += (long)(wait_ms % 1000) * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        notified = ETIMEDOUT != pthread_cond_timedwait(&ev->cond, &ev->lock, &ts);
+    }
+    atomic_fetch_sub(&ev->waiters, 1);
+    pthread_mutex_unlock(&ev->lock);
+#elif defined(CONFIG_FreeRTOS)
+    TickType_t ticks = portMAX_DELAY;
+    if (0 < wait_ms) ticks = NO_LESS_THAN(pdMS_TO_TICKS(wait_ms), 1);
+    notified = pdTRUE == xSemaphoreTake(ev->sem, ticks);
+    atomic_fetch_sub(&ev->waiters, 1);
+#endif /* _ESP_PLATFORM */
+    return notified;
+}
+
+/***
+ * @description : wake up waiters of the event
+ * @param        {os_event} *ev - pointer to event
+ * @return       {*}
+ */
+void os_event_notify(os_event *ev)
+{
+    // condition changed by caller before, ordered with load of waiters
+    atomic_thread_fence(memory_order_seq_cst);
+    if (0 == atomic_load(&ev->waiters)) return;
+#if defined(__linux__) || defined(__linux)
+    pthread_mutex_lock(&ev->lock);
+    pthread_cond_broadcast(&ev->cond);
+    pthread_mutex_unlock(&ev->lock);
+#elif defined(CONFIG_FreeRTOS)
+    // one token per waiter seen, stale tokens only cause a spurious wakeup
+    for (int n = atomic_load(&ev->waiters); n > 0; n--) {
+        if (pdTRUE != xSemaphoreGive(ev->sem)) break;
+    }
+#endif /* _ESP_PLATFORM */
+}
@@ -0,0 +1,144 @@
+/***
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 09:12:40
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 09:12:40
+ * @FilePath    : /activetask/components/activetask/os_sync.h
+ * @Description : blocking primitives over pthread / FreeRTOS
+ * @Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#ifndef _OS_SYNC_H_
+#define _OS_SYNC_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#if defined(__linux__) || defined(__linux)
+#include <pthread.h>
+#elif defined(CONFIG_FreeRTOS)
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#endif /* _ESP_PLATFORM */
+
+#include "inner_err.h"
+
+#ifndef OS_EVENT_MAX_COUNT
+#define OS_EVENT_MAX_COUNT      32
+#endif /* OS_EVENT_MAX_COUNT */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * os_mutex is a plain sleeping lock for slow paths, never for hot paths
+ */
+typedef struct os_mutex_t os_mutex;
+
+struct os_mutex_t {
+#if defined(__linux__) || defined(__linux)
+    pthread_mutex_t              mutex;
+#elif defined(CONFIG_FreeRTOS)
+    SemaphoreHandle_t            mutex;
+#endif /* _ESP_PLATFORM */
+};
+
+/**
+ * os_event is a wakeup channel without state of its own: the waiter owns the
+ * condition (e.g. "queue not empty") and re-checks it between prepare and wait,
+ * the peer changes the condition first and notifies afterwards. Notify costs a
+ * fence and an atomic load when nobody is waiting; prepare has the paired fence.
+ *
+ *      os_event_prepare(ev);
+ *      if (condition()) os_event_cancel(ev);
+ *      else os_event_wait(ev, wait_ms);
+ */
+typedef struct os_event_t os_event;
+
+struct os_event_t {
+    atomic_int                 waiters;     // number of prepared waiters
+#if defined(__linux__) || defined(__linux)
+    pthread_mutex_t               lock;
+    pthread_cond_t                cond;
+#elif defined(CONFIG_FreeRTOS)
+    SemaphoreHandle_t              sem;     // counting semaphore as wakeup tokens
+#endif /* _ESP_PLATFORM */
+};
+
+/***
+ * @description : init a mutex
+ * @param        {os_mutex} *mtx - pointer to mutex
+ * @return       {*}
+ */
+at_error_t os_mutex_init(os_mutex *mtx);
+
+/***
+ * @description : clear a mutex
+ * @param        {os_mutex} *mtx - pointer to mutex
+ * @return       {*}
+ */
+void os_mutex_fini(os_mutex *mtx);
+
+/***
+ * @description : lock a mutex, wait forever
+ * @param        {os_mutex} *mtx - pointer to mutex
+ * @return       {*}
+ */
+void os_mutex_lock(os_mutex *mtx);
+
+/***
+ * @description : unlock a mutex
+ * @param        {os_mutex} *mtx - pointer to mutex
+ * @return       {*}
+ */
+void os_mutex_unlock(os_mutex *mtx);
+
+/***
+ * @description : init an event
+ * @param        {os_event} *ev - pointer to event
+ * @return       {*}
+ */
+at_error_t os_event_init(os_event *ev);
+
+/***
+ * @description : clear an event, no waiter is allowed
+ * @param        {os_event} *ev - pointer to event
+ * @return       {*}
+ */
+void os_event_fini(os_event *ev);
+
+/***
+ * @description : register as a waiter, must be followed by wait or cancel
+ * @param        {os_event} *ev - pointer to event
+ * @return       {*}
+ */
+void os_event_prepare(os_event *ev);
+
+/***
+ * @description : unregister a waiter prepared, when condition became true
+ * @param        {os_event} *ev - pointer to event
+ * @return       {*}
+ */
+void os_event_cancel(os_event *ev);
+
+/***
+ * @description : block until notified or timeout, spurious wakeup is possible
+ * @param        {os_event} *ev - pointer to event
+ * @param        {int} wait_ms - wait time in ms, 0 means forever
+ * @return       {*} - false if timeout
+ */
+bool os_event_wait(os_event *ev, int wait_ms);
+
+/***
+ * @description : wake up waiters of the event
+ * @param        {os_event} *ev - pointer to event
+ * @return       {*}
+ */
+void os_event_notify(os_event *ev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _OS_SYNC_H_ */
@@ -0,0 +1,289 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 15:03:12
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 16:21:40
+ * @FilePath    : /activetask/components/activetask/task_executor.c
+ * @Description :
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#if defined(__linux__) || defined(__linux)
+#include <sys/sysinfo.h>
+#endif /* __linux__ */
+
+#include "linux_macros.h"
+#include "circ_queue.h"
+#include "os_sync.h"
+#include "timer_wheel.h"
+#include "blk_track.h"
+#include "task_executor.h"
+
+typedef struct task_worker_t task_worker;
+
+struct task_worker_t {
+    active_task                  *task;
+    circ_queue                   *runq;     // runnable tasks, may be stolen
+    circ_queue                 *pinned;     // tasks pinned to this worker
+    os_event                     event;     // wakeup when idle
+    atomic_bool               sleeping;
+};
+
+typedef struct {
+    atomic_int                   tasks;     // number of tasks attached
+    atomic_uint                   next;     // round robin for kicks from outside
+    int                     worker_num;
+    task_worker workers[TASK_EXECUTOR_WORKERS];
+    atomic_bool                running;
+} task_executor;
+
+static task_executor g_executor;
+
+static __thread task_worker *t_worker = NULL;   // worker of current thread
+
+/* wake up a sleeping worker, the target first then anyone for stealing */
+static void executor_wakeup(task_executor *exec, task_worker *target)
+{
+    if (atomic_load(&target->sleeping)) {
+        os_event_notify(&target->event);
+        return;
+    }
+    for (int i = 0; i < exec->worker_num; i++) {
+        if (atomic_load(&exec->workers[i].sleeping)) {
+            os_event_notify(&exec->workers[i].event);
+            return;
+        }
+    }
+}
+
+/* put a runnable task into a run queue, never full as tasks are queued once */
+static void executor_enqueue(task_executor *exec, active_task *task)
+{
+    task_worker *worker;
+    circ_queue *runq;
+    if (!atomic_load(&exec->running)) return;   // no workers to take it
+    if (task->pinned) {
+        worker = &exec->workers[task->core_id % exec->worker_num];
+        runq = worker->pinned;
+    } else {
+        // stay on current worker for cache, or spread kicks from outside
+        worker = NULL != t_worker ? t_worker
+            : &exec->workers[atomic_fetch_add(&exec->next, 1) % exec->worker_num];
+        runq = worker->runq;
+    }
+    runq->queue_push(runq, task, QUEUE_WAIT_FOREVER);
+    // pairs with sleeping flag set by worker before checking queues again
+    atomic_thread_fence(memory_order_seq_cst);
+    executor_wakeup(exec, worker);
+}
+
+/* run a step of a task popped from run queue */
+static void executor_run(task_executor *exec, active_task *task)
+{
+    atomic_store(&task->sched_state, TASK_SCHED_RUNNING);
+    const char *owner = blk_track_get_owner();
+    blk_track_set_owner(task->name);    // blocks malloced in step owned by task
+    at_error_t ret = task->task_step(task);
+    blk_track_set_owner(owner);
+    if (TASK_SVC_BREAK == ret) {
+        KRNL_DEBUG("pooled task %s end\n", task->name);
+        atomic_store(&task->sched_state, TASK_SCHED_DONE);
+        atomic_fetch_sub(&exec->tasks, 1);
+        return;
+    }
+    int state = TASK_SCHED_RUNNING;
+    if (TASK_SVC_CONTINUE != ret
+        && atomic_compare_exchange_strong(&task->sched_state, &state, TASK_SCHED_IDLE))
+        return;
+    // more work left, or kicked while running
+    atomic_store(&task->sched_state, TASK_SCHED_QUEUED);
+    executor_enqueue(exec, task);
+}
+
+/* take half of the tasks queued on the busiest other worker */
+static active_task *executor_steal(task_executor *exec, task_worker *self)
+{
+    void *tasks[TASK_EXECUTOR_TASKS / 2];
+    task_worker *victim = NULL;
+    unsigned int most = 0;
+    for (int i = 0; i < exec->worker_num; i++) {
+        if (self == &exec->workers[i]) continue;
+        unsigned int count = circ_queue_count(exec->workers[i].runq);
+        if (count > most) {
+            most = count;
+            victim = &exec->workers[i];
+        }
+    }
+    if (NULL == victim) return NULL;
+    int num = NO_MORE_THAN(NO_LESS_THAN(most / 2, 1), TASK_EXECUTOR_TASKS / 2);
+    if (INNER_RES_OK != victim->runq->queue_pop_n(victim->runq, tasks, &num, QUEUE_NO_WAIT))
+        return NULL;
+    // run the first, keep the rest on own queue
+    if (1 < num) {
+        int rest = num - 1;
+        self->runq->queue_push_n(self->runq, &tasks[1], &rest, QUEUE_WAIT_FOREVER);
+    }
+    return (active_task *)tasks[0];
+}
+
+/* find a task to run: pinned, own queue, then steal */
+static active_task *worker_next(task_executor *exec, task_worker *worker)
+{
+    void *task = NULL;
+    if (INNER_RES_OK == worker->pinned->queue_pop(worker->pinned, &task, QUEUE_NO_WAIT)
+        || INNER_RES_OK == worker->runq->queue_pop(worker->runq, &task, QUEUE_NO_WAIT))
+        return (active_task *)task;
+    return executor_steal(exec, worker);
+}
+
+static at_error_t worker_on_loop(active_task *task)
+{
+    task_worker *worker = (task_worker *)task->app_data;
+    task_executor *exec = &g_executor;
+    t_worker = worker;
+
+    active_task *next = worker_next(exec, worker);
+    if (NULL == next) {
+        // check again after marked as sleeping, kicks in between wake us up
+        os_event_prepare(&worker->event);
+        atomic_store(&worker->sleeping, true);
+        if (NULL != (next = worker_next(exec, worker))) os_event_cancel(&worker->event);
+        else os_event_wait(&worker->event, QUEUE_WAIT_FOREVER);
+        atomic_store(&worker->sleeping, false);
+    }
+    if (NULL != next) executor_run(exec, next);
+    return TASK_SVC_CONTINUE;
+}
+
+/* release queues and event of a worker */
+static void worker_fini(task_worker *worker)
+{
+    if (NULL != worker->runq) circ_queue_delete(worker->runq);
+    if (NULL != worker->pinned) circ_queue_delete(worker->pinned);
+    os_event_fini(&worker->event);
+    worker->runq = NULL;
+    worker->pinned = NULL;
+}
+
+/* prepare queues and event of a worker */
+static at_error_t worker_init(task_worker *worker)
+{
+    worker->task = NULL;
+    atomic_init(&worker->sleeping, false);
+    if (INNER_RES_OK != os_event_init(&worker->event)) return MEMORY_MALLOC_FAILED;
+    worker->runq = circ_queue_create(TASK_EXECUTOR_TASKS, QUEUE_F_POLL);
+    worker->pinned = circ_queue_create(TASK_EXECUTOR_TASKS, QUEUE_F_POLL);
+    if (NULL == worker->runq || NULL == worker->pinned) {
+        worker_fini(worker);
+        return MEMORY_MALLOC_FAILED;
+    }
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : start workers of executor, and timer wheel if not yet
+ * @param        {int} worker_num - number of workers, 0 means one per core
+ * @param        {int} priority - priority of workers
+ * @return       {*}
+ */
+at_error_t task_executor_init(int worker_num, int priority)
+{
+    task_executor *exec = &g_executor;
+    if (atomic_load(&exec->running)) return INNER_RES_OK;  // already inited
+
+    if (0 >= worker_num) {
+#if defined(__linux__) || defined(__linux)
+        worker_num = get_nprocs();
+#elif defined(CONFIG_FreeRTOS)
+        worker_num = portNUM_PROCESSORS;
+#endif /* _ESP_PLATFORM */
+    }
+    worker_num = NO_MORE_THAN(NO_LESS_THAN(worker_num, 1), TASK_EXECUTOR_WORKERS);
+
+    // timers of pooled tasks only work with timer wheel
+    at_error_t res = timer_wheel_init(priority, 0);
+    if (INNER_RES_OK != res) return res;
+
+    atomic_init(&exec->tasks, 0);
+    atomic_init(&exec->next, 0);
+    exec->worker_num = 0;
+    for (int i = 0; i < worker_num; i++) {
+        task_worker *worker = &exec->workers[i];
+        if (INNER_RES_OK != worker_init(worker)) break;
+        char name[24];   // "worker_" and any int
+        snprintf(name, sizeof(name), "worker_%d", i);
+        worker->task = active_task_create(name, 0, TASK_EXECUTOR_STACK,
+                priority, i, 0, 0, 0, worker);
+        if (NULL == worker->task) {
+            worker_fini(worker);
+            break;
+        }
+        worker->task->on_loop = worker_on_loop;
+        // count the worker before it runs, others may steal from it
+        exec->worker_num++;
+        if (INNER_RES_OK != worker->task->task_begin(worker->task)) {
+            exec->worker_num--;
+            active_task_delete(worker->task);
+            worker_fini(worker);
+            break;
+        }
+    }
+    if (0 == exec->worker_num) {
+        KRNL_ERROR("executor failed to create workers\n");
+        return TASK_FAILED_CREATE;
+    }
+    atomic_store(&exec->running, true);
+    KRNL_INFO("executor started with %d workers\n", exec->worker_num);
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : check if executor is running
+ * @return       {*}
+ */
+bool task_executor_running(void)
+{
+    return atomic_load(&g_executor.running);
+}
+
+/***
+ * @description : attach a pooled task to executor, called by task_begin
+ * @param        {active_task} *task - pointer to active task
+ * @return       {*}
+ */
+at_error_t task_executor_attach(active_task *task)
+{
+    if (NULL == task || NULL == task->task_step) return INNER_INVAILD_PARAM;
+    task_executor *exec = &g_executor;
+    if (!atomic_load(&exec->running)) return EXECUTOR_NOT_RUNNING;
+    // run queues never fill up as long as each task is queued at most once
+    if (TASK_EXECUTOR_TASKS <= atomic_fetch_add(&exec->tasks, 1)) {
+        atomic_fetch_sub(&exec->tasks, 1);
+        KRNL_ERROR("executor full, task %s not attached\n", task->name);
+        return TASK_FAILED_CREATE;
+    }
+    atomic_store(&task->sched_state, TASK_SCHED_IDLE);
+    task_executor_kick(task);   // first step, for on_loop
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : make a pooled task runnable, safe from any thread
+ * @param        {active_task} *task - pointer to active task
+ * @return       {*}
+ */
+void task_executor_kick(active_task *task)
+{
+    if (!atomic_load(&g_executor.running)) return;
+    int state = atomic_load(&task->sched_state);
+    int next;
+    do {
+        if (TASK_SCHED_IDLE == state) next = TASK_SCHED_QUEUED;
+        else if (TASK_SCHED_RUNNING == state) next = TASK_SCHED_DIRTY;
+        else return;    // queued, dirty or done already
+    } while (!atomic_compare_exchange_weak(&task->sched_state, &state, next));
+    if (TASK_SCHED_QUEUED == next) executor_enqueue(&g_executor, task);
+}
@@ -0,0 +1,65 @@
+/***
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 15:02:47
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 15:02:47
+ * @FilePath    : /activetask/components/activetask/task_executor.h
+ * @Description : M:N executor running pooled active tasks on worker threads
+ * @Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#ifndef _TASK_EXECUTOR_H_
+#define _TASK_EXECUTOR_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "inner_err.h"
+#include "active_task.h"
+
+#ifndef TASK_EXECUTOR_TASKS
+#define TASK_EXECUTOR_TASKS     64      // max pooled tasks, power of 2
+#endif /* TASK_EXECUTOR_TASKS */
+
+#ifndef TASK_EXECUTOR_STACK
+#define TASK_EXECUTOR_STACK     4096    // stack of a worker, shared by pooled tasks
+#endif /* TASK_EXECUTOR_STACK */
+
+#define TASK_EXECUTOR_WORKERS   4       // max workers
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***
+ * @description : start workers of executor, and timer wheel if not yet
+ * @param        {int} worker_num - number of workers, 0 means one per core
+ * @param        {int} priority - priority of workers
+ * @return       {*}
+ */
+at_error_t task_executor_init(int worker_num, int priority);
+
+/***
+ * @description : check if executor is running
+ * @return       {*}
+ */
+bool task_executor_running(void);
+
+/***
+ * @description : attach a pooled task to executor, called by task_begin
+ * @param        {active_task} *task - pointer to active task
+ * @return       {*}
+ */
+at_error_t task_executor_attach(active_task *task);
+
+/***
+ * @description : make a pooled task runnable, safe from any thread
+ * @param        {active_task} *task - pointer to active task
+ * @return       {*}
+ */
+void task_executor_kick(active_task *task);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TASK_EXECUTOR_H_ */
@@ -0,0 +1,290 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 13:20:36
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 13:20:36
+ * @FilePath    : /activetask/components/activetask/timer_wheel.c
+ * @Description :
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#include "linux_macros.h"
+#include "os_sync.h"
+#include "active_task.h"
+#include "timer_wheel.h"
+
+enum {
+    TIMER_IDLE,             // not armed
+    TIMER_PENDING,          // in a slot of wheel, or picked to fire
+    TIMER_FIRING,           // callback running
+    TIMER_CANCELED,         // deleted while callback running
+};
+
+#define TIMER_WHEEL_MASK    (TIMER_WHEEL_SLOTS - 1)
+
+#define LEVEL_SHIFT(lvl)    (TIMER_WHEEL_BITS * (lvl))
+
+typedef struct {
+    os_mutex                      lock;     // protect slots & timer states
+    os_event                     event;     // wake up wheel task when idle
+    active_task                  *task;
+    unsigned long              base_ms;     // time of tick 0
+    unsigned long             now_tick;     // last tick processed
+    atomic_int                 pending;     // number of timers armed
+    atomic_bool                running;
+    struct list_head slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} timer_wheel;
+
+static timer_wheel g_timer_wheel;
+
+/***
+ * @description : init a timer before any use
+ * @param        {at_timer} *timer - pointer to timer
+ * @param        {on_timer_expire} on_expire - callback when expires
+ * @param        {void} *arg - user defined parameter for callback
+ * @return       {*}
+ */
+void at_timer_init(at_timer *timer, on_timer_expire on_expire, void *arg)
+{
+    if (NULL == timer) return;
+    INIT_LIST_HEAD(&timer->node);
+    timer->expires = 0;
+    timer->period = 0;
+    timer->mode = AT_TIMER_ONESHOT;
+    timer->state = TIMER_IDLE;
+    timer->on_expire = on_expire;
+    timer->arg = arg;
+}
+
+/* put timer into the slot by distance to its due tick, lock held */
+static void wheel_enqueue(timer_wheel *wheel, at_timer *timer)
+{
+    unsigned long expires = timer->expires;
+    long delta = (long)(expires - wheel->now_tick);
+    if (0 >= delta) {
+        // overdue, fire at next tick
+        expires = wheel->now_tick + 1;
+        delta = 1;
+    }
+    int lvl = 0;
+    for (; lvl < TIMER_WHEEL_LEVELS; lvl++) {
+        if (delta < (1L << LEVEL_SHIFT(lvl + 1))) break;
+    }
+    if (TIMER_WHEEL_LEVELS == lvl) {
+        // out of range, park at the farthest slot and cascade again from there
+        lvl = TIMER_WHEEL_LEVELS - 1;
+        expires = wheel->now_tick + (1UL << LEVEL_SHIFT(TIMER_WHEEL_LEVELS)) - 1;
+    }
+    int idx = (expires >> LEVEL_SHIFT(lvl)) & TIMER_WHEEL_MASK;
+    list_add_tail(&timer->node, &wheel->slots[lvl][idx]);
+}
+
+/* re-arm a periodic timer after fired, lock held */
+static void wheel_rearm(timer_wheel *wheel, at_timer *timer)
+{
+    if (AT_TIMER_FIXED_RATE == timer->mode) {
+        // next due counted from last due, skip the periods already missed
+        do {
+            timer->expires += timer->period;
+        } while (0 >= (long)(timer->expires - wheel->now_tick));
+    } else {
+        timer->expires = wheel->now_tick + timer->period;
+    }
+    timer->state = TIMER_PENDING;
+    wheel_enqueue(wheel, timer);
+}
+
+/* move forward one tick and fire timers due, lock held */
+static void wheel_tick(timer_wheel *wheel)
+{
+    struct list_head temp;
+    at_timer *timer, *next;
+
+    wheel->now_tick++;
+    // cascade timers of upper level when lower level wraps
+    for (int lvl = 1; lvl < TIMER_WHEEL_LEVELS; lvl++) {
+        if (0 != (wheel->now_tick & ((1UL << LEVEL_SHIFT(lvl)) - 1))) break;
+        int idx = (wheel->now_tick >> LEVEL_SHIFT(lvl)) & TIMER_WHEEL_MASK;
+        INIT_LIST_HEAD(&temp);
+        list_splice_init(&wheel->slots[lvl][idx], &temp);
+        list_for_each_entry_safe(timer, next, &temp, node) {
+            list_del_init(&timer->node);
+            if (0 >= (long)(timer->expires - wheel->now_tick)) {
+                // due on this tick, fired below with level 0 slot
+                list_add_tail(&timer->node, &wheel->slots[0][wheel->now_tick & TIMER_WHEEL_MASK]);
+            } else {
+                wheel_enqueue(wheel, timer);
+            }
+        }
+    }
+
+    INIT_LIST_HEAD(&temp);
+    list_splice_init(&wheel->slots[0][wheel->now_tick & TIMER_WHEEL_MASK], &temp);
+    // pick one by one, timer_wheel_del may remove others while unlocked
+    while (!list_empty(&temp)) {
+        timer = list_first_entry(&temp, at_timer, node);
+        list_del_init(&timer->node);
+        timer->state = TIMER_FIRING;
+        os_mutex_unlock(&wheel->lock);
+
+        if (NULL != timer->on_expire) timer->on_expire(timer, timer->arg);
+
+        os_mutex_lock(&wheel->lock);
+        if (TIMER_FIRING == timer->state && AT_TIMER_ONESHOT != timer->mode) {
+            wheel_rearm(wheel, timer);
+        } else if (TIMER_FIRING == timer->state || TIMER_CANCELED == timer->state) {
+            timer->state = TIMER_IDLE;
+            atomic_fetch_sub(&wheel->pending, 1);
+        }
+        // TIMER_PENDING: re-armed by timer_wheel_add in callback time
+    }
+}
+
+static at_error_t wheel_on_loop(active_task *task)
+{
+    timer_wheel *wheel = &g_timer_wheel;
+    unsigned long cur = (get_sys_ms() - wheel->base_ms) / TIMER_WHEEL_TICK_MS;
+
+    os_mutex_lock(&wheel->lock);
+    if (0 == atomic_load(&wheel->pending)) {
+        wheel->now_tick = cur;  // nothing armed, jump over idle ticks
+    }
+    while (0 < (long)(cur - wheel->now_tick)) {
+        wheel_tick(wheel);
+    }
+    unsigned long next_ms = wheel->base_ms + (wheel->now_tick + 1) * TIMER_WHEEL_TICK_MS;
+    os_mutex_unlock(&wheel->lock);
+
+    // sleep to next tick, or until a timer armed if idle
+    os_event_prepare(&wheel->event);
+    int left = (int)(next_ms - get_sys_ms());
+    if (0 >= left) {
+        os_event_cancel(&wheel->event);
+    } else {
+        os_event_wait(&wheel->event,
+            0 == atomic_load(&wheel->pending) ? QUEUE_WAIT_FOREVER : left);
+    }
+    return TASK_SVC_CONTINUE;
+}
+
+/***
+ * @description : start the timer wheel task
+ * @param        {int} priority - priority of timer wheel task
+ * @param        {int} core - cpu affinity
+ * @return       {*}
+ */
+at_error_t timer_wheel_init(int priority, int core)
+{
+    timer_wheel *wheel = &g_timer_wheel;
+    if (atomic_load(&wheel->running)) return INNER_RES_OK;  // already inited
+
+    for (int lvl = 0; lvl < TIMER_WHEEL_LEVELS; lvl++) {
+        for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) INIT_LIST_HEAD(&wheel->slots[lvl][i]);
+    }
+    wheel->base_ms = get_sys_ms();
+    wheel->now_tick = 0;
+    atomic_init(&wheel->pending, 0);
+    if (INNER_RES_OK != os_mutex_init(&wheel->lock)) return MEMORY_MALLOC_FAILED;
+    if (INNER_RES_OK != os_event_init(&wheel->event)) {
+        os_mutex_fini(&wheel->lock);
+        return MEMORY_MALLOC_FAILED;
+    }
+
+    wheel->task = active_task_create("timer_wheel", 0, TIMER_WHEEL_STACK,
+            priority, core, 0, 0, 0, wheel);
+    if (NULL == wheel->task) {
+        os_event_fini(&wheel->event);
+        os_mutex_fini(&wheel->lock);
+        return TASK_FAILED_CREATE;
+    }
+    wheel->task->on_loop = wheel_on_loop;
+    atomic_store(&wheel->running, true);
+    at_error_t res = wheel->task->task_begin(wheel->task);
+    if (INNER_RES_OK != res) {
+        atomic_store(&wheel->running, false);
+        active_task_delete(wheel->task);
+        os_event_fini(&wheel->event);
+        os_mutex_fini(&wheel->lock);
+        return res;
+    }
+    KRNL_INFO("timer wheel started, tick %d ms\n", TIMER_WHEEL_TICK_MS);
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : check if timer wheel is running
+ * @return       {*}
+ */
+bool timer_wheel_running(void)
+{
+    return atomic_load(&g_timer_wheel.running);
+}
+
+/***
+ * @description : arm a timer, re-arm if it's pending already
+ * @param        {at_timer} *timer - pointer to timer
+ * @param        {int} delay_ms - first expiration in ms
+ * @param        {int} period_ms - period in ms, for periodic mode
+ * @param        {at_timer_mode} mode - timer mode
+ * @return       {*}
+ */
+at_error_t timer_wheel_add(at_timer *timer, int delay_ms, int period_ms, at_timer_mode mode)
+{
+    if (NULL == timer || 0 > delay_ms) return INNER_INVAILD_PARAM;
+    if (AT_TIMER_ONESHOT != mode && 0 >= period_ms) return INNER_INVAILD_PARAM;
+    timer_wheel *wheel = &g_timer_wheel;
+    if (!atomic_load(&wheel->running)) return TIMER_WHEEL_STOPPED;
+
+    os_mutex_lock(&wheel->lock);
+    if (0 == atomic_load(&wheel->pending)) {
+        // wheel is idle and may not have ticked for long, catch up first
+        wheel->now_tick = (get_sys_ms() - wheel->base_ms) / TIMER_WHEEL_TICK_MS;
+    }
+    if (TIMER_PENDING == timer->state) {
+        list_del_init(&timer->node);
+    } else if (TIMER_IDLE == timer->state) {
+        atomic_fetch_add(&wheel->pending, 1);
+    }
+    // TIMER_FIRING/TIMER_CANCELED: still counted in pending
+    timer->mode = mode;
+    timer->period = NO_LESS_THAN((period_ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS, 1);
+    timer->expires = wheel->now_tick
+            + NO_LESS_THAN((delay_ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS, 1);
+    timer->state = TIMER_PENDING;
+    wheel_enqueue(wheel, timer);
+    os_mutex_unlock(&wheel->lock);
+
+    os_event_notify(&wheel->event);
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : cancel a timer, wait for its callback if running
+ * @param        {at_timer} *timer - pointer to timer
+ * @return       {*}
+ */
+void timer_wheel_del(at_timer *timer)
+{
+    if (NULL == timer) return;
+    timer_wheel *wheel = &g_timer_wheel;
+    if (!atomic_load(&wheel->running)) return;
+
+    os_mutex_lock(&wheel->lock);
+    if (TIMER_PENDING == timer->state) {
+        list_del_init(&timer->node);
+        timer->state = TIMER_IDLE;
+        atomic_fetch_sub(&wheel->pending, 1);
+    } else if (TIMER_FIRING == timer->state) {
+        timer->state = TIMER_CANCELED;
+    }
+    // wait for the callback running
+    while (TIMER_CANCELED == timer->state) {
+        os_mutex_unlock(&wheel->lock);
+        delay_ms(1);
+        os_mutex_lock(&wheel->lock);
+    }
+    os_mutex_unlock(&wheel->lock);
+}
@@ -0,0 +1,106 @@
+/***
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 13:20:11
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 13:20:11
+ * @FilePath    : /activetask/components/activetask/timer_wheel.h
+ * @Description : shared hierarchical timer wheel
+ * @Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#ifndef _TIMER_WHEEL_H_
+#define _TIMER_WHEEL_H_
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "inner_err.h"
+#include "linux_list.h"
+
+#ifndef TIMER_WHEEL_TICK_MS
+#define TIMER_WHEEL_TICK_MS     10
+#endif /* TIMER_WHEEL_TICK_MS */
+
+#ifndef TIMER_WHEEL_STACK
+#define TIMER_WHEEL_STACK       4096
+#endif /* TIMER_WHEEL_STACK */
+
+#define TIMER_WHEEL_BITS        6
+#define TIMER_WHEEL_SLOTS       (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS      3       // 2^18 ticks in range, longer cascaded again
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    AT_TIMER_ONESHOT,       // fire once
+    AT_TIMER_PERIODIC,      // re-armed from the time it fired
+    AT_TIMER_FIXED_RATE,    // re-armed from the time it was due, no drift
+} at_timer_mode;
+
+typedef struct at_timer_t at_timer;
+
+/***
+ * @description : callback when timer expires, runs in timer wheel task
+ *                  and must not block or delete the timer
+ * @param        {at_timer} *timer - pointer to timer
+ * @param        {void} *arg - user defined parameter
+ * @return       {*}
+ */
+typedef void (*on_timer_expire)(at_timer *timer, void *arg);
+
+struct at_timer_t {
+    struct list_head              node;     // node in wheel slot
+    unsigned long              expires;     // due tick
+    unsigned long               period;     // ticks for periodic timer
+    at_timer_mode                 mode;
+    int                          state;     // inner state, see timer_wheel.c
+    on_timer_expire          on_expire;
+    void                          *arg;
+};
+
+/***
+ * @description : init a timer before any use
+ * @param        {at_timer} *timer - pointer to timer
+ * @param        {on_timer_expire} on_expire - callback when expires
+ * @param        {void} *arg - user defined parameter for callback
+ * @return       {*}
+ */
+void at_timer_init(at_timer *timer, on_timer_expire on_expire, void *arg);
+
+/***
+ * @description : start the timer wheel task
+ * @param        {int} priority - priority of timer wheel task
+ * @param        {int} core - cpu affinity
+ * @return       {*}
+ */
+at_error_t timer_wheel_init(int priority, int core);
+
+/***
+ * @description : check if timer wheel is running
+ * @return       {*}
+ */
+bool timer_wheel_running(void);
+
+/***
+ * @description : arm a timer, re-arm if it's pending already
+ * @param        {at_timer} *timer - pointer to timer
+ * @param        {int} delay_ms - first expiration in ms
+ * @param        {int} period_ms - period in ms, for periodic mode
+ * @param        {at_timer_mode} mode - timer mode
+ * @return       {*}
+ */
+at_error_t timer_wheel_add(at_timer *timer, int delay_ms, int period_ms, at_timer_mode mode);
+
+/***
+ * @description : cancel a timer, wait for its callback if running
+ * @param        {at_timer} *timer - pointer to timer
+ * @return       {*}
+ */
+void timer_wheel_del(at_timer *timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _TIMER_WHEEL_H_ */
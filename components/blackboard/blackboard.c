@@ -7,15 +7,19 @@
  * @Description :
  * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
  */
+#include <assert.h>
 #include <stdatomic.h>
 
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "nvs.h"
+#if defined(BLACKBOARD_HASH_MD5)
 #include "mbedtls/md5.h"
+#endif /* BLACKBOARD_HASH_MD5 */
 
 #include "inner_err.h"
-#include "linux_llist.h"
+#include "linux_hlist.h"
+#include "os_sync.h"
 
 #include "blackboard.h"
 
@@ -25,23 +29,68 @@
 #define BB_WARN(fmt, ...)   ESP_LOGW(BB_TAG, fmt, ##__VA_ARGS__)
 #define BB_ERROR(fmt, ...)  ESP_LOGE(BB_TAG, fmt, ##__VA_ARGS__)
 
-#define BB_MAP_SIZE (1<<BLACKBOARD_MAP_BITS)
+#define BB_SEQ_SPIN         64      // tries before backing off a writer in progress
+#define BB_SEQ_BACKOFF_MS   10      // a tick at 100 Hz, preempted writer may finish
+
+typedef struct _bb_subscriber bb_subscriber;
+
+/* task told of changes of data, kept until blackboard_fini */
+struct _bb_subscriber {
+    bb_subscriber                *next;
+    _Atomic(active_task *)        task;     // NULL once unsubscribed
+    int                       msg_type;
+    blackboard_handle           handle;
+    atomic_bool                pending;     // notice not taken yet
+};
+
+/* content of a notice msg block */
+typedef struct {
+    bb_subscriber                 *sub;
+} bb_notice_msg;
 
 typedef struct
 {
     char                          *key;
     bool                     persisted;
+    bool                     unclaimed;     // loaded from NVS, not registered by user yet
     size_t                   data_size;
-    struct llist_node             node;
+    blackboard_handle           handle;
+    atomic_uint                    seq;     // odd while written
+    _Atomic(bb_subscriber *)      subs;     // pushed under lock, read without
     void                       *rd_ptr;
 } bb_datablk;
 
 #define SIZE_BB_DATABLK     sizeof(bb_datablk)
 
+typedef struct _bb_index bb_index;
+
+/**
+ * Open addressing index with linear probing, arrays in one allocation.
+ * A slot is taken once and never freed, so readers probe without lock:
+ * the writer fills handle and key table before storing the hash with
+ * release, and a reader stops at the first empty (0) hash.
+ *
+ * On growth the writer builds a larger index and swaps the pointer.
+ * The old index is kept until blackboard_fini, as readers may still
+ * probe it, which costs less than half of the current index in total.
+ */
+struct _bb_index {
+    bb_index                     *next;     // retired, older
+    unsigned int              slot_num;     // power of two
+    int                        key_cap;     // handles, half of slots
+    _Atomic uint32_t           *hashes;     // hash of key in slot, 0 if empty
+    blackboard_handle         *handles;     // handle of key in slot
+    bb_datablk                  **keys;     // by handle
+    void                        **data;     // rd_ptr of keys, for get by handle
+};
+
 typedef struct
 {
     size_t                   buff_size;
-    struct llist_head bb_map[BB_MAP_SIZE];
+    _Atomic(bb_index *)          index;
+    bb_index                  *retired;     // replaced by growth
+    int                        key_num;     // handles given
+    os_mutex                      lock;     // writers of index
     void                         *base;
     atomic_int                  wr_pos;
     nvs_handle_t                  hnvs;
@@ -49,21 +98,109 @@ typedef struct
 
 static bb_datamap g_bb_map;
 
+static blackboard_handle bb_register(const char *key, size_t data_size,
+        bool persisted, bool loaded);
+
+/***
+ * @description : hash of key, 0 kept for empty slots, by FNV-1a or, with
+ *                  BLACKBOARD_HASH_MD5 defined and mbedtls required, by the
+ *                  former MD5 to compare
+ * @param        {char} *key - name of data
+ * @return       {*}
+ */
+static inline uint32_t bb_hash(const char *key)
+{
+#if defined(BLACKBOARD_HASH_MD5)
+    mbedtls_md5_context ctx;
+    unsigned char digest[16];
+
+    mbedtls_md5_init(&ctx);
+    mbedtls_md5_starts(&ctx);
+    mbedtls_md5_update(&ctx, (const unsigned char *)key, strlen(key));
+    mbedtls_md5_finish(&ctx, digest);
+    mbedtls_md5_free(&ctx);
+    uint32_t h = (uint32_t)digest[3] << 24 | digest[2] << 16 | digest[1] << 8 | digest[0];
+#else
+    uint32_t h = hash_fnv1a(key);
+#endif /* BLACKBOARD_HASH_MD5 */
+    return 0 == h ? 1 : h;
+}
+
+/* first slot to probe, high bits of FNV folded in as they are mixed best */
+static inline unsigned int bb_slot(uint32_t hash, unsigned int mask)
+{
+    return (hash ^ (hash >> 16)) & mask;
+}
+
+/* malloc an empty index for key_num keys at least */
+static bb_index *bb_index_alloc(int key_num)
+{
+    unsigned int slot_num = 8;
+    while (slot_num < 2 * (unsigned int)key_num) slot_num <<= 1;
+    int key_cap = slot_num / 2;
+    size_t size = sizeof(bb_index)
+            + slot_num * (sizeof(_Atomic uint32_t) + sizeof(blackboard_handle))
+            + key_cap * (sizeof(bb_datablk *) + sizeof(void *));
+    bb_index *idx = (bb_index *)calloc(1, size);
+    if (NULL == idx) return NULL;
+    // pointers first for alignment
+    idx->keys = (bb_datablk **)(idx + 1);
+    idx->data = (void **)(idx->keys + key_cap);
+    idx->hashes = (_Atomic uint32_t *)(idx->data + key_cap);
+    idx->handles = (blackboard_handle *)(idx->hashes + slot_num);
+    idx->slot_num = slot_num;
+    idx->key_cap = key_cap;
+    return idx;
+}
+
+/* put handle of key in index, key table filled before */
+static void bb_index_insert(bb_index *idx, uint32_t hash, blackboard_handle handle)
+{
+    unsigned int mask = idx->slot_num - 1;
+    unsigned int i = bb_slot(hash, mask);
+    while (0 != atomic_load_explicit(&idx->hashes[i], memory_order_relaxed))
+        i = (i + 1) & mask;
+    idx->handles[i] = handle;
+    atomic_store_explicit(&idx->hashes[i], hash, memory_order_release);
+}
+
+/* double the index with lock held, readers switch at the swap */
+static bb_index *bb_index_grow(bb_index *old)
+{
+    bb_index *idx = bb_index_alloc(2 * old->key_cap);
+    if (NULL == idx) return NULL;
+    for (int h = 0; h < g_bb_map.key_num; h++) {
+        idx->keys[h] = old->keys[h];
+        idx->data[h] = old->data[h];
+        if (NULL != idx->keys[h]) bb_index_insert(idx, bb_hash(idx->keys[h]->key), h);
+    }
+    old->next = g_bb_map.retired;
+    g_bb_map.retired = old;
+    atomic_store_explicit(&g_bb_map.index, idx, memory_order_release);
+    BB_INFO("index grown to %u slots", idx->slot_num);
+    return idx;
+}
+
 /***
  * @description : init black board
  * @param        {size_t} buff_size - size of black board
+ * @param        {int} key_num - number of keys expected, index grows if more
  * @return       {*}
  */
-void blackboard_init(size_t buff_size)
+void blackboard_init(size_t buff_size, int key_num)
 {
     if (NULL != g_bb_map.base) return;  // already inited
     g_bb_map.buff_size = buff_size;
     g_bb_map.base = malloc(buff_size);
     assert("Failed to malloc for Black Board" && NULL != g_bb_map.base);
     g_bb_map.wr_pos = ATOMIC_VAR_INIT(0);
-    for (int i = 0; i < BB_MAP_SIZE; i++) {
-        init_llist_head(&g_bb_map.bb_map[i]);
-    }
+    g_bb_map.key_num = 0;
+    g_bb_map.retired = NULL;
+    bb_index *idx = bb_index_alloc(0 < key_num ? key_num : BLACKBOARD_KEY_NUM);
+    assert("Failed to malloc for Black Board index" && NULL != idx);
+    atomic_init(&g_bb_map.index, idx);
+    at_error_t res = os_mutex_init(&g_bb_map.lock);
+    assert("Failed to init lock of Black Board" && INNER_RES_OK == res);
 
     // open NVS
     esp_err_t err = nvs_open("BlackBoard", NVS_READWRITE, &g_bb_map.hnvs);
@@ -108,10 +245,9 @@ void blackboard_init(size_t buff_size)
             }
             // move wr_pos in blackboard_register
 
-            err = blackboard_register(info.key, length, true);
-            if (ESP_OK != err)
+            if (BLACKBOARD_HANDLE_INVALID == bb_register(info.key, length, true, true))
             {
-                BB_ERROR("register %s failed due to %d", info.key, err);
+                BB_ERROR("register %s failed", info.key);
                 assert(false);
             }
             cap -= length;
@@ -140,36 +276,46 @@ void blackboard_fini(void)
     free(g_bb_map.base);
     g_bb_map.wr_pos = ATOMIC_VAR_INIT(0);
 
-    for (int i = 0; i < BB_MAP_SIZE; i++) {
-        while (!llist_empty(&g_bb_map.bb_map[i])) {
-            struct llist_node *pnode = llist_del_first(&g_bb_map.bb_map[i]);
-            bb_datablk *db = llist_entry(pnode, bb_datablk, node);
-            BB_INFO("recycle %s", db->key);
-            free(db->key);
-            free(db);
+    bb_index *idx = atomic_load(&g_bb_map.index);
+    for (int h = 0; h < g_bb_map.key_num; h++) {
+        bb_datablk *db = idx->keys[h];
+        if (NULL == db) continue;
+        BB_INFO("recycle %s", db->key);
+        bb_subscriber *sub;
+        while (NULL != (sub = atomic_load(&db->subs))) {
+            atomic_store(&db->subs, sub->next);
+            free(sub);
         }
+        free(db->key);
+        free(db);
     }
+    free(idx);
+    while (NULL != (idx = g_bb_map.retired)) {
+        g_bb_map.retired = idx->next;
+        free(idx);
+    }
+    atomic_store(&g_bb_map.index, NULL);
+    g_bb_map.key_num = 0;
+    os_mutex_fini(&g_bb_map.lock);
+    g_bb_map.base = NULL;
 }
 
-static inline unsigned int hash_min(const char *val, size_t bits)
+/* find data registered, probe from slot of hash, safe with writers */
+static bb_datablk *bb_find(const char *key)
 {
-    mbedtls_md5_context ctx;
-    unsigned char decrypt[16];
-
-    mbedtls_md5_init(&ctx);
-    mbedtls_md5_starts(&ctx);
-    mbedtls_md5_update(&ctx, (unsigned char *)val, strlen(val));
-    mbedtls_md5_finish(&ctx, decrypt);
-    mbedtls_md5_free(&ctx);
-    BB_DEBUG("%s md5 is:[", val);
-    for (int i = 0; i < 16; i++)
-        BB_DEBUG("%02x", decrypt[i]);
-    BB_DEBUG("]\n");
-
-    uint32_t digest = (decrypt[3] << 24 | decrypt[2] << 16 \
-                        | decrypt[1] << 8 | decrypt[0]) >> (32 - bits);
-    BB_DEBUG("%s md5 digest is:<%lx>", val, digest);
-    return digest;
+    bb_index *idx = atomic_load_explicit(&g_bb_map.index, memory_order_acquire);
+    uint32_t hash = bb_hash(key);
+    unsigned int mask = idx->slot_num - 1;
+    for (unsigned int i = bb_slot(hash, mask); ; i = (i + 1) & mask) {
+        uint32_t h = atomic_load_explicit(&idx->hashes[i], memory_order_acquire);
+        if (0 == h) return NULL;
+        if (h != hash) continue;
+        bb_datablk *db = idx->keys[idx->handles[i]];
+        if (0 == strcmp(db->key, key)) {
+            BB_DEBUG("find %s at %p", key, db);
+            return db;
+        }
+    }
 }
 
 /***
@@ -179,18 +325,33 @@ static inline unsigned int hash_min(const char *val, size_t bits)
  */
 void *blackboard_get(const char *key)
 {
-    struct llist_head mhead = g_bb_map.bb_map[hash_min(key, BLACKBOARD_MAP_BITS)];
+    if (NULL == key) return NULL;
+    bb_datablk *db = bb_find(key);
+    return NULL != db ? db->rd_ptr : NULL;
+}
 
-    if (llist_empty(&mhead)) return NULL;
+/***
+ * @description : get data from black board by handle, no lookup of key
+ * @param        {blackboard_handle} handle - handle of data
+ * @return       {*} - pointer to data, NULL if handle invalid
+ */
+void *blackboard_get_h(blackboard_handle handle)
+{
+    bb_index *idx = atomic_load_explicit(&g_bb_map.index, memory_order_acquire);
+    if ((unsigned int)handle >= (unsigned int)idx->key_cap) return NULL;
+    return idx->data[handle];
+}
 
-    bb_datablk *db = NULL;
-    llist_for_each_entry(db, &mhead, node) {
-        if (0 == strcmp(db->key, key)) {
-            BB_DEBUG("find %s at %p", key, db);
-            return db->rd_ptr;
-        }
-    }
-    return NULL;
+/***
+ * @description : find handle of data registered
+ * @param        {char} *key - name of data
+ * @return       {*} - handle, BLACKBOARD_HANDLE_INVALID if not registered
+ */
+blackboard_handle blackboard_lookup(const char *key)
+{
+    if (NULL == key) return BLACKBOARD_HANDLE_INVALID;
+    bb_datablk *db = bb_find(key);
+    return NULL != db ? db->handle : BLACKBOARD_HANDLE_INVALID;
 }
 
 static bool has_space(size_t s)
@@ -198,44 +359,286 @@ static bool has_space(size_t s)
     return g_bb_map.buff_size - atomic_load(&g_bb_map.wr_pos) >= s;
 }
 
-/***
- * @description : register data into black board
- * @param        {char} *key - name of data
- * @param        {size_t} data_size - size of data
- * @param        {bool} persisted - if data is persisted
- * @return       {*}
- */
-at_error_t blackboard_register(const char *key, size_t data_size,
-        bool persisted)
+/* register data, loaded if its content already read from NVS at wr_pos */
+static blackboard_handle bb_register(const char *key, size_t data_size,
+        bool persisted, bool loaded)
 {
-    if (NULL == key) return INNER_INVAILD_PARAM;
+    if (NULL == key) return BLACKBOARD_HANDLE_INVALID;
+
+    os_mutex_lock(&g_bb_map.lock);
+    blackboard_handle handle = BLACKBOARD_HANDLE_INVALID;
+    bb_datablk *db = bb_find(key);
+    if (NULL != db) {
+        if (db->data_size < data_size && db->unclaimed && has_space(data_size)) {
+            // value stored by an older build is shorter, move it to a larger area
+            void *rd = g_bb_map.base + atomic_fetch_add(&g_bb_map.wr_pos, data_size);
+            memcpy(rd, db->rd_ptr, db->data_size);
+            memset(rd + db->data_size, 0, data_size - db->data_size);
+            BB_INFO("%s loaded with %u bytes, enlarged to %u", key,
+                    (unsigned int)db->data_size, (unsigned int)data_size);
+            db->rd_ptr = rd;
+            db->data_size = data_size;
+            atomic_load_explicit(&g_bb_map.index, memory_order_relaxed)->data[db->handle] = rd;
+        }
+        if (!loaded) db->unclaimed = false;
+        if (db->data_size >= data_size) handle = db->handle;
+        else BB_ERROR("%s registered with %u bytes, %u wanted", key,
+                (unsigned int)db->data_size, (unsigned int)data_size);
+        goto done;
+    }
+    if (!has_space(data_size)) {
+        BB_ERROR("failed to check space");
+        goto done;
+    }
+    bb_index *idx = atomic_load_explicit(&g_bb_map.index, memory_order_relaxed);
+    if (g_bb_map.key_num == idx->key_cap && NULL == (idx = bb_index_grow(idx))) {
+        BB_ERROR("failed to grow index for %s", key);
+        goto done;
+    }
 
-    bb_datablk *db = (bb_datablk *)malloc(SIZE_BB_DATABLK);
+    db = (bb_datablk *)malloc(SIZE_BB_DATABLK);
     if (NULL == db) {
         BB_ERROR("failed to malloc for bb datablk");
-        return BB_LACK_SPACE;
+        goto done;
     }
     db->key = strdup(key);
     db->persisted = persisted;
+    db->unclaimed = loaded;
     db->data_size = data_size;
-
-    if (!has_space(data_size)) {
-        BB_ERROR("failed to check space");
+    if (NULL == db->key) {
+        BB_ERROR("failed to malloc for key %s", key);
         free(db);
-        return BB_LACK_SPACE;
+        goto done;
     }
     int pos = atomic_fetch_add(&g_bb_map.wr_pos, data_size);
-    // check before wirte
-    if (g_bb_map.buff_size - pos < data_size) {
-        // other writer move wr_pos before this fetch
-        BB_ERROR("failed to double check space");
-        free(db);
-        return BB_LACK_SPACE;
+    db->rd_ptr = g_bb_map.base + pos;
+    if (!loaded) memset(db->rd_ptr, 0, data_size);
+    atomic_init(&db->seq, 0);
+    atomic_init(&db->subs, NULL);
+    handle = db->handle = g_bb_map.key_num++;
+    idx->keys[handle] = db;
+    idx->data[handle] = db->rd_ptr;
+    bb_index_insert(idx, bb_hash(key), handle);    // visible to readers
+done:
+    os_mutex_unlock(&g_bb_map.lock);
+    return handle;
+}
+
+/***
+ * @description : register data into black board, data of new key cleared,
+ *                  handle of registered key returned if its data large enough,
+ *                  data loaded from NVS enlarged on its first registration
+ * @param        {char} *key - name of data
+ * @param        {size_t} data_size - size of data
+ * @param        {bool} persisted - if data is persisted
+ * @return       {*} - handle, BLACKBOARD_HANDLE_INVALID if failed
+ */
+blackboard_handle blackboard_register(const char *key, size_t data_size,
+        bool persisted)
+{
+    return bb_register(key, data_size, persisted, false);
+}
+
+/***
+ * @description : register keys of a table and set their handles
+ * @param        {blackboard_key} *keys - key table
+ * @param        {int} num - number of keys in table
+ * @return       {*} - BB_LACK_SPACE if any key failed, its handle invalid
+ */
+at_error_t blackboard_resolve(const blackboard_key *keys, int num)
+{
+    if (NULL == keys || 0 > num) return INNER_INVAILD_PARAM;
+    at_error_t res = INNER_RES_OK;
+    for (int i = 0; i < num; i++) {
+        *keys[i].handle = blackboard_register(keys[i].key, keys[i].data_size, keys[i].persisted);
+        if (BLACKBOARD_HANDLE_INVALID == *keys[i].handle) res = BB_LACK_SPACE;
+    }
+    return res;
+}
+
+/* data of handle, NULL if invalid */
+static bb_datablk *bb_get_datablk(blackboard_handle handle)
+{
+    bb_index *idx = atomic_load_explicit(&g_bb_map.index, memory_order_acquire);
+    if ((unsigned int)handle >= (unsigned int)idx->key_cap) return NULL;
+    return idx->keys[handle];
+}
+
+/***
+ * @description : get size of data registered
+ * @param        {blackboard_handle} handle - handle of data
+ * @return       {*} - size of data, 0 if handle invalid
+ */
+size_t blackboard_data_size(blackboard_handle handle)
+{
+    bb_datablk *db = bb_get_datablk(handle);
+    return NULL != db ? db->data_size : 0;
+}
+
+/* put a notice to subscribers without one pending, never blocks */
+static void bb_notify(bb_datablk *db)
+{
+    bb_subscriber *sub = atomic_load_explicit(&db->subs, memory_order_acquire);
+    for (; NULL != sub; sub = sub->next) {
+        active_task *task = atomic_load_explicit(&sub->task, memory_order_relaxed);
+        // a task stopped reads the latest data once begun again
+        if (NULL == task || TASK_STATE_RUNNING != atomic_load(&task->run_state)) continue;
+        // coalesced into the notice pending, data written seen when it is taken
+        if (atomic_exchange_explicit(&sub->pending, true, memory_order_acq_rel)) continue;
+
+        bb_notice_msg msg = {sub};
+        msgblk *mb = msgblk_malloc_inline(sizeof(msg));
+        if (NULL == mb) {
+            BB_ERROR("failed to malloc notice of %s for %s", db->key, task->name);
+            atomic_store(&sub->pending, false);
+            continue;
+        }
+        datablk *dblk = msgblk_first_datablk(mb);
+        mb->msg_type = sub->msg_type;
+        memcpy(dblk->wr_ptr, &msg, sizeof(msg));
+        datablk_move_wr(dblk, sizeof(msg));
+        if (INNER_RES_OK != task->put_message(task, mb, QUEUE_NO_WAIT)) {
+            BB_WARN("failed to notify %s of %s", task->name, db->key);
+            atomic_store(&sub->pending, false);
+        }
+        msgblk_free(mb);    // held by queue of task
+    }
+}
+
+/* copy out len bytes of data, retried until no writer ran in between */
+static void bb_read(bb_datablk *db, void *dst, size_t len)
+{
+    for (int tries = 1; ; tries++) {
+        unsigned int seq = atomic_load_explicit(&db->seq, memory_order_acquire);
+        if (0 == (seq & 1)) {
+            memcpy(dst, db->rd_ptr, len);
+            atomic_thread_fence(memory_order_acquire);
+            if (seq == atomic_load_explicit(&db->seq, memory_order_relaxed)) return;
+        }
+        if (0 == tries % BB_SEQ_SPIN) delay_ms(BB_SEQ_BACKOFF_MS);
+    }
+}
+
+/***
+ * @description : write data of handle, readers by blackboard_read never
+ *                  see a partial write, writers of the same data serialized
+ * @param        {blackboard_handle} handle - handle of data
+ * @param        {void} *src - data written from offset 0
+ * @param        {size_t} len - bytes written, no more than data size
+ * @return       {*}
+ */
+at_error_t blackboard_write(blackboard_handle handle, const void *src, size_t len)
+{
+    bb_datablk *db = bb_get_datablk(handle);
+    if (NULL == db) return BB_KEY_NOT_EXIST;
+    if (NULL == src || len > db->data_size) return INNER_INVAILD_PARAM;
+
+    // take the entry by making seq odd
+    unsigned int seq = atomic_load_explicit(&db->seq, memory_order_relaxed);
+    for (int tries = 1; ; tries++) {
+        if (0 == (seq & 1) && atomic_compare_exchange_weak_explicit(&db->seq, &seq, seq + 1,
+                memory_order_acquire, memory_order_relaxed))
+            break;
+        if (0 == tries % BB_SEQ_SPIN) delay_ms(BB_SEQ_BACKOFF_MS);
+        seq = atomic_load_explicit(&db->seq, memory_order_relaxed);
     }
-    db->rd_ptr = g_bb_map.base + pos;   // assgin again
+    atomic_thread_fence(memory_order_release);  // odd seq seen before data
+    memcpy(db->rd_ptr, src, len);
+    atomic_store_explicit(&db->seq, seq + 2, memory_order_release);
+    bb_notify(db);
+    return INNER_RES_OK;
+}
 
-    struct llist_head mhead = g_bb_map.bb_map[hash_min(key, BLACKBOARD_MAP_BITS)];
-    llist_add(&db->node, &mhead);   // add to hash map
+/***
+ * @description : read data of handle consistently, never blocks a writer,
+ *                  retried only if a write ran in between
+ * @param        {blackboard_handle} handle - handle of data
+ * @param        {void} *dst - buffer of len bytes at least
+ * @param        {size_t} len - bytes read from offset 0, no more than data size
+ * @return       {*}
+ */
+at_error_t blackboard_read(blackboard_handle handle, void *dst, size_t len)
+{
+    bb_datablk *db = bb_get_datablk(handle);
+    if (NULL == db) return BB_KEY_NOT_EXIST;
+    if (NULL == dst || len > db->data_size) return INNER_INVAILD_PARAM;
+    bb_read(db, dst, len);
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : subscribe changes of data by blackboard_write, a msg block
+ *                  of msg_type put to task, writes coalesced until taken
+ * @param        {blackboard_handle} handle - handle of data
+ * @param        {active_task} *task - task notified
+ * @param        {int} msg_type - type of msg block notified
+ * @return       {*}
+ */
+at_error_t blackboard_subscribe(blackboard_handle handle, active_task *task, int msg_type)
+{
+    if (NULL == task) return INNER_INVAILD_PARAM;
+    bb_datablk *db = bb_get_datablk(handle);
+    if (NULL == db) return BB_KEY_NOT_EXIST;
+
+    bb_subscriber *sub = (bb_subscriber *)malloc(sizeof(bb_subscriber));
+    if (NULL == sub) {
+        BB_ERROR("failed to malloc subscriber of %s for %s", db->key, task->name);
+        return MEMORY_MALLOC_FAILED;
+    }
+    atomic_init(&sub->task, task);
+    sub->msg_type = msg_type;
+    sub->handle = handle;
+    atomic_init(&sub->pending, false);
+    os_mutex_lock(&g_bb_map.lock);
+    sub->next = atomic_load_explicit(&db->subs, memory_order_relaxed);
+    atomic_store_explicit(&db->subs, sub, memory_order_release);
+    os_mutex_unlock(&g_bb_map.lock);
+    BB_INFO("%s subscribed %s with msg_type %d", task->name, db->key, msg_type);
+    return INNER_RES_OK;
+}
+
+/***
+ * @description : stop notifying task of changes of data
+ * @param        {blackboard_handle} handle - handle of data
+ * @param        {active_task} *task - task notified
+ * @return       {*}
+ */
+void blackboard_unsubscribe(blackboard_handle handle, active_task *task)
+{
+    bb_datablk *db = bb_get_datablk(handle);
+    if (NULL == db || NULL == task) return;
+
+    // notices in flight may still point to subscriber, so it is kept
+    os_mutex_lock(&g_bb_map.lock);
+    bb_subscriber *sub = atomic_load_explicit(&db->subs, memory_order_relaxed);
+    for (; NULL != sub; sub = sub->next) {
+        if (task == atomic_load_explicit(&sub->task, memory_order_relaxed))
+            atomic_store_explicit(&sub->task, NULL, memory_order_relaxed);
+    }
+    os_mutex_unlock(&g_bb_map.lock);
+}
+
+/***
+ * @description : take notice from msg block got by subscriber, every notice
+ *                  must be taken to get the next, read data after taken
+ * @param        {msgblk} *mblk - msg block notified
+ * @param        {blackboard_notice} *notice - handle and version of data
+ * @return       {*} - INNER_INVAILD_PARAM if not a notice
+ */
+at_error_t blackboard_notify_take(msgblk *mblk, blackboard_notice *notice)
+{
+    if (NULL == mblk || NULL == notice) return INNER_INVAILD_PARAM;
+    datablk *dblk = msgblk_first_datablk(mblk);
+    if (NULL == dblk || sizeof(bb_notice_msg) != (size_t)datablk_length(dblk))
+        return INNER_INVAILD_PARAM;
+
+    bb_notice_msg msg;
+    memcpy(&msg, dblk->rd_ptr, sizeof(msg));
+    // writes coalesced before are seen, writes after put a new notice
+    atomic_exchange_explicit(&msg.sub->pending, false, memory_order_acq_rel);
+    bb_datablk *db = bb_get_datablk(msg.sub->handle);
+    notice->handle = msg.sub->handle;
+    notice->version = atomic_load_explicit(&db->seq, memory_order_acquire) / 2;
     return INNER_RES_OK;
 }
 
@@ -247,13 +650,24 @@ at_error_t blackboard_register(const char *key, size_t data_size,
 at_error_t blackboard_flush(const char *key)
 {
     if (NULL == key) return INNER_INVAILD_PARAM;
+    return blackboard_flush_h(blackboard_lookup(key));
+}
 
-    void *rd = blackboard_get(key);
-    if (NULL == rd) return BB_KEY_NOT_EXIST;
-
-    bb_datablk *db = container_of(rd, bb_datablk, rd_ptr);
-
-    // save data to NVS
-    esp_err_t err = nvs_set_blob(g_bb_map.hnvs, key, db->rd_ptr, db->data_size);
+/***
+ * @description : flush data of handle into nvs
+ * @param        {blackboard_handle} handle - handle of data
+ * @return       {*}
+ */
+at_error_t blackboard_flush_h(blackboard_handle handle)
+{
+    bb_datablk *db = bb_get_datablk(handle);
+    if (NULL == db) return BB_KEY_NOT_EXIST;
+
+    // save a consistent copy to NVS
+    void *copy = malloc(db->data_size);
+    if (NULL == copy) return BB_LACK_SPACE;
+    bb_read(db, copy, db->data_size);
+    esp_err_t err = nvs_set_blob(g_bb_map.hnvs, db->key, copy, db->data_size);
+    free(copy);
     return ESP_OK != err ? err : nvs_commit(g_bb_map.hnvs);
 }
@@ -16,23 +16,58 @@
 #include <string.h>
 
 #include "inner_err.h"
+#include "msg_blk.h"
+#include "active_task.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#define BLACKBOARD_MAP_BITS     3
+#ifndef BLACKBOARD_KEY_NUM
+#define BLACKBOARD_KEY_NUM      16      // keys expected if not given to init
+#endif /* BLACKBOARD_KEY_NUM */
 
 #define BB_ERR_BASE                 0x411000
 #define BB_LACK_SPACE               (BB_ERR_BASE+ 1)
 #define BB_KEY_NOT_EXIST            (BB_ERR_BASE+ 2)
 
+/**
+ * handle of a key, index of its data, stable until blackboard_fini,
+ * also across growth of the index
+ */
+typedef int blackboard_handle;
+
+#define BLACKBOARD_HANDLE_INVALID   (-1)
+
+/**
+ * entry of a key table, registered and resolved to handle at once by
+ * blackboard_resolve, so that the key is never looked up again
+ */
+typedef struct {
+    const char                    *key;
+    size_t                   data_size;
+    bool                     persisted;
+    blackboard_handle          *handle;
+} blackboard_key;
+
+#define BLACKBOARD_KEY(key, data_size, persisted, handle) \
+    {(key), (data_size), (persisted), &(handle)}
+
+/**
+ * change of data told to a subscriber, taken from its msg block
+ */
+typedef struct {
+    blackboard_handle           handle;
+    unsigned int               version;     // writes done, latest when taken
+} blackboard_notice;
+
 /***
  * @description : init black board
  * @param        {size_t} buff_size - size of black board
+ * @param        {int} key_num - number of keys expected, index grows if more
  * @return       {*}
  */
-void blackboard_init(size_t buff_size);
+void blackboard_init(size_t buff_size, int key_num);
 
 /***
  * @description : fini black board
@@ -48,13 +83,91 @@ void blackboard_fini(void);
 void *blackboard_get(const char *key);
 
 /***
- * @description : register data into black board
+ * @description : get data from black board by handle, no lookup of key
+ * @param        {blackboard_handle} handle - handle of data
+ * @return       {*} - pointer to data, NULL if handle invalid
+ */
+void *blackboard_get_h(blackboard_handle handle);
+
+/***
+ * @description : get size of data registered
+ * @param        {blackboard_handle} handle - handle of data
+ * @return       {*} - size of data, 0 if handle invalid
+ */
+size_t blackboard_data_size(blackboard_handle handle);
+
+/***
+ * @description : find handle of data registered
+ * @param        {char} *key - name of data
+ * @return       {*} - handle, BLACKBOARD_HANDLE_INVALID if not registered
+ */
+blackboard_handle blackboard_lookup(const char *key);
+
+/***
+ * @description : register data into black board, data of new key cleared,
+ *                  handle of registered key returned if its data large enough,
+ *                  data loaded from NVS enlarged on its first registration
  * @param        {char} *key - name of data
  * @param        {size_t} data_size - size of data
  * @param        {bool} persisted - if data is persisted
+ * @return       {*} - handle, BLACKBOARD_HANDLE_INVALID if failed
+ */
+blackboard_handle blackboard_register(const char *key, size_t data_size, bool persisted);
+
+/***
+ * @description : register keys of a table and set their handles
+ * @param        {blackboard_key} *keys - key table
+ * @param        {int} num - number of keys in table
+ * @return       {*} - BB_LACK_SPACE if any key failed, its handle invalid
+ */
+at_error_t blackboard_resolve(const blackboard_key *keys, int num);
+
+/***
+ * @description : write data of handle, readers by blackboard_read never
+ *                  see a partial write, writers of the same data serialized
+ * @param        {blackboard_handle} handle - handle of data
+ * @param        {void} *src - data written from offset 0
+ * @param        {size_t} len - bytes written, no more than data size
+ * @return       {*}
+ */
+at_error_t blackboard_write(blackboard_handle handle, const void *src, size_t len);
+
+/***
+ * @description : read data of handle consistently, never blocks a writer,
+ *                  retried only if a write ran in between
+ * @param        {blackboard_handle} handle - handle of data
+ * @param        {void} *dst - buffer of len bytes at least
+ * @param        {size_t} len - bytes read from offset 0, no more than data size
+ * @return       {*}
+ */
+at_error_t blackboard_read(blackboard_handle handle, void *dst, size_t len);
+
+/***
+ * @description : subscribe changes of data by blackboard_write, a msg block
+ *                  of msg_type put to task, writes coalesced until taken
+ * @param        {blackboard_handle} handle - handle of data
+ * @param        {active_task} *task - task notified
+ * @param        {int} msg_type - type of msg block notified
+ * @return       {*}
+ */
+at_error_t blackboard_subscribe(blackboard_handle handle, active_task *task, int msg_type);
+
+/***
+ * @description : stop notifying task of changes of data
+ * @param        {blackboard_handle} handle - handle of data
+ * @param        {active_task} *task - task notified
  * @return       {*}
  */
-at_error_t blackboard_register(const char *key, size_t data_size, bool persisted);
+void blackboard_unsubscribe(blackboard_handle handle, active_task *task);
+
+/***
+ * @description : take notice from msg block got by subscriber, every notice
+ *                  must be taken to get the next, read data after taken
+ * @param        {msgblk} *mblk - msg block notified
+ * @param        {blackboard_notice} *notice - handle and version of data
+ * @return       {*} - INNER_INVAILD_PARAM if not a notice
+ */
+at_error_t blackboard_notify_take(msgblk *mblk, blackboard_notice *notice);
 
 /***
  * @description : flush black board into nvs
@@ -63,11 +176,30 @@ at_error_t blackboard_register(const char *key, size_t data_size, bool persisted
  */
 at_error_t blackboard_flush(const char *key);
 
+/***
+ * @description : flush data of handle into nvs
+ * @param        {blackboard_handle} handle - handle of data
+ * @return       {*}
+ */
+at_error_t blackboard_flush_h(blackboard_handle handle);
+
 /**
  * get data from black board as specified type
  */
 #define blackboard_get_as(key, T)  ((T *)blackboard_get(key))
 
+/**
+ * get data from black board by handle as specified type, a raw pointer,
+ * use blackboard_read/blackboard_write for data shared between tasks
+ */
+#define blackboard_get_as_h(handle, T)  ((T *)blackboard_get_h(handle))
+
+/**
+ * register and resolve all keys of a static key table
+ */
+#define blackboard_resolve_table(table) \
+    blackboard_resolve((table), (int)(sizeof(table) / sizeof((table)[0])))
+
 /**
  * register a persist data into black board
  */
@@ -9,6 +9,7 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <string.h>
 
@@ -51,22 +52,41 @@ typedef struct {
 
 #define SIZE_MQTT_TASK          sizeof(mqtt_task)
 
-static mqtt_topics *get_by_topic(mqtt_task *mt, const char *topic)
+#ifndef MQTT_URI_SIZE
+#ifdef CONFIG_MQTT_URI_SIZE
+#define MQTT_URI_SIZE       CONFIG_MQTT_URI_SIZE
+#else
+#define MQTT_URI_SIZE       128
+#endif /* CONFIG_MQTT_URI_SIZE */
+#endif /* MQTT_URI_SIZE */
+
+#define MQTT_MSG_CONFIG     (-2)    // blackboard notice, negative types never mapped to topics
+
+static blackboard_handle h_broker_uri = BLACKBOARD_HANDLE_INVALID;
+
+/* blackboard keys of mqtt, resolved once by mqtt_on_init */
+static const blackboard_key mqtt_keys[] = {
+    BLACKBOARD_KEY("mqtt_broker_uri", MQTT_URI_SIZE, true, h_broker_uri),
+};
+
+/* topic of mqtt event is not terminated by '\0' */
+static mqtt_topics *get_by_topic(mqtt_task *mt, const char *topic, int topic_len)
 {
-    if (NULL == mt || NULL == topic) return NULL;
+    if (NULL == mt || NULL == topic || 0 >= topic_len) return NULL;
 
     if (list_empty(&mt->recv_topics)) {
-        MQTT_INFO("empty recv topics, can't find %s", topic);
+        MQTT_INFO("empty recv topics, can't find %.*s", topic_len, topic);
         return NULL;
     }
 
     mqtt_topics *mq_topic = NULL;
     list_for_each_entry(mq_topic, &mt->recv_topics, node) {
-        if (0 == strcmp(topic, mq_topic->topic)) {
+        if (0 == strncmp(topic, mq_topic->topic, topic_len) &&
+                '\0' == mq_topic->topic[topic_len]) {
             return mq_topic;
         }
     }
-    MQTT_ERROR("can't find topic %s", topic);
+    MQTT_ERROR("can't find topic %.*s", topic_len, topic);
     return NULL;
 }
 
@@ -80,7 +100,7 @@ static mqtt_topics *get_by_msg_type(mqtt_task *mt, int msg_type)
     }
 
     mqtt_topics *mq_topic = NULL;
-    list_for_each_entry(mq_topic, &mt->recv_topics, node) {
+    list_for_each_entry(mq_topic, &mt->send_topics, node) {
         if (msg_type == mq_topic->msg_type) {
             return mq_topic;
         }
@@ -96,34 +116,30 @@ static void log_error_if_nonzero(const char *message, int error_code)
     }
 }
 
-static void process_mqtt_data(mqtt_task *mt, char *topic, char *data, int data_len)
+static void process_mqtt_data(mqtt_task *mt, char *topic, int topic_len,
+        char *data, int data_len)
 {
     if (NULL == mt || NULL == data || 0 >= data_len) return;
-    if (NULL == mt->act_task.next_task) return;
+    if (!active_task_has_next(&mt->act_task)) return;
 
     // find topic
-    mqtt_topics *mq_topic = get_by_topic(mt, topic);
+    mqtt_topics *mq_topic = get_by_topic(mt, topic, topic_len);
     if (NULL == mq_topic) {
         return;
     }
 
-    // prepare msgblk & datablk
-    datablk *db = datablk_malloc(data_len);
-    if (NULL == db) {
-        MQTT_ERROR("failed to malloc datablk for msg from %s", topic);
-        return;
-    }
-
-    msgblk *mb = msgblk_malloc(db);
+    // prepare msgblk & datablk, small payload inline in msgblk
+    msgblk *mb = msgblk_malloc_inline(data_len);
     if (NULL == mb) {
-        MQTT_ERROR("failed to malloc msgblk for msg from %s", topic);
-        datablk_free(db);
+        MQTT_ERROR("failed to malloc msgblk for msg from %.*s", topic_len, topic);
         return;
     }
+    datablk *db = msgblk_first_datablk(mb);
     mb->msg_type = mq_topic->msg_type;
     memcpy(db->wr_ptr, data, data_len);
     datablk_move_wr(db, data_len);
     mt->act_task.put_message_next(&mt->act_task, mb, mt->act_task.interv_ms);
+    msgblk_free(mb);    // downstream tasks hold their own references
 }
 
 static void mqtt_subscrib_topics(mqtt_task *mt)
@@ -156,7 +172,7 @@ static void mqtt_subscrib_topics(mqtt_task *mt)
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
         int32_t event_id, void *event_data)
 {
-    MQTT_DEBUG("Event dispatched from event loop base=%s, event_id=%ld", base, event_id);
+    MQTT_DEBUG("Event dispatched from event loop base=%s, event_id=%" PRIi32, base, event_id);
     mqtt_task *mt = (mqtt_task *)handler_args;
     protocol_layer *layer = (protocol_layer *)mt->act_task.app_data;
 
@@ -187,7 +203,7 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
         MQTT_INFO("MQTT_EVENT_DATA");
         // printf("TOPIC=%.*s\r\n", event->topic_len, event->topic);
         // printf("DATA=%.*s\r\n", event->data_len, event->data);
-        process_mqtt_data(mt, event->topic, event->data, event->data_len);
+        process_mqtt_data(mt, event->topic, event->topic_len, event->data, event->data_len);
         break;
     case MQTT_EVENT_ERROR:
         MQTT_INFO("MQTT_EVENT_ERROR");
@@ -202,6 +218,9 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
         MQTT_INFO("Other event id:%d", event->event_id);
         break;
     }
+    // blocks cached on the esp-mqtt task, which is not an active task and never flushes
+    msgblk_thread_flush();
+    datablk_thread_flush();
 }
 
 static at_error_t mqtt_on_init(active_task *task)
@@ -220,25 +239,26 @@ static at_error_t mqtt_on_init(active_task *task)
     }
     MQTT_INFO("WiFi connected");
 
-    const char uri_key[] = "mqtt_broker_uri\0";
-
     // init mqtt client
-    mt->broker_uri = (char *)blackboard_get(uri_key);
-    if (NULL == mt->broker_uri) {
-        // register and flush
-        at_error_t res = blackboard_persist(uri_key, strlen(CONFIG_MQTT_BROKER_URL)+1);
-        if (INNER_RES_OK != res) {
-            MQTT_ERROR("failed to register broker URI");
-            return res;
-        }
-        mt->broker_uri = (char *)blackboard_get(uri_key);
-        sprintf(mt->broker_uri, "%s", CONFIG_MQTT_BROKER_URL);
-        res = blackboard_flush(uri_key);
+    if (INNER_RES_OK != (res = blackboard_resolve_table(mqtt_keys))) {
+        MQTT_ERROR("failed to register broker URI");
+        return res;
+    }
+    mt->broker_uri = blackboard_get_as_h(h_broker_uri, char);
+    if ('\0' == mt->broker_uri[0]) {
+        // new key, not loaded from NVS, store default
+        res = blackboard_write(h_broker_uri, CONFIG_MQTT_BROKER_URL, sizeof(CONFIG_MQTT_BROKER_URL));
+        if (INNER_RES_OK == res) res = blackboard_flush_h(h_broker_uri);
         if (INNER_RES_OK != res) {
             MQTT_ERROR("failed to store broker URI");
             return res;
         }
     }
+    // reconnect once broker URI changed
+    if (INNER_RES_OK != (res = blackboard_subscribe(h_broker_uri, task, MQTT_MSG_CONFIG))) {
+        MQTT_ERROR("failed to subscribe broker URI");
+        return res;
+    }
 
     esp_mqtt_client_config_t mqtt_cfg = {
         .broker.address.uri = mt->broker_uri,
@@ -250,7 +270,22 @@ static at_error_t mqtt_on_init(active_task *task)
     esp_mqtt_client_register_event(mt->client, ESP_EVENT_ANY_ID, mqtt_event_handler, task);
     esp_mqtt_client_start(mt->client);
     MQTT_INFO("MQTT Client starting ...");
-    return TASK_SVC_CONTINUE;
+    return INNER_RES_OK;
+}
+
+/* task ended, undo mqtt_on_init so that the task can begin again */
+static at_error_t mqtt_on_fini(active_task *task)
+{
+    if (NULL == task) return INNER_INVAILD_PARAM;
+    MQTT_DEBUG("%s fini", task->name);
+    mqtt_task *mt = container_of(task, mqtt_task, act_task);
+    blackboard_unsubscribe(h_broker_uri, task);
+    if (NULL != mt->client) {
+        esp_mqtt_client_stop(mt->client);
+        esp_mqtt_client_destroy(mt->client);
+        mt->client = NULL;
+    }
+    return INNER_RES_OK;
 }
 
 static at_error_t mqtt_on_loop(active_task *task)
@@ -267,19 +302,42 @@ static at_error_t mqtt_on_loop(active_task *task)
     return INNER_RES_OK;
 }
 
+/* broker URI changed on blackboard, reconnect to the latest one */
+static at_error_t mqtt_on_config(mqtt_task *mt, msgblk *mblk)
+{
+    blackboard_notice notice;
+    if (INNER_RES_OK != blackboard_notify_take(mblk, &notice) || h_broker_uri != notice.handle)
+        return INNER_RES_OK;    // mblk released in task_svc function
+
+    size_t size = blackboard_data_size(h_broker_uri);
+    char *uri = (char *)malloc(size);
+    if (NULL == uri) {
+        MQTT_ERROR("failed to malloc for broker URI");
+        return INNER_RES_OK;    // mblk released in task_svc function
+    }
+    blackboard_read(h_broker_uri, uri, size);
+    uri[size - 1] = '\0';
+    MQTT_INFO("broker URI changed to %s, version %u", uri, notice.version);
+    esp_mqtt_client_stop(mt->client);
+    if (ESP_OK != esp_mqtt_client_set_uri(mt->client, uri))
+        MQTT_ERROR("failed to set broker URI %s", uri);
+    esp_mqtt_client_start(mt->client);
+    free(uri);
+    return INNER_RES_OK;    // mblk released in task_svc function
+}
+
 static at_error_t mqtt_on_message(active_task *task, msgblk *mblk)
 {
     if (NULL == task || NULL == mblk) return INNER_INVAILD_PARAM;
     MQTT_DEBUG("%s handle message %p", task->name, mblk);
-    datablk *db = msgblk_first_datablk(mblk);
-    if (NULL == db) {
+    if (NULL == msgblk_first_datablk(mblk)) {
         MQTT_ERROR("ignore msg %p due to empty datablk", mblk);
         return INNER_RES_OK;    // mblk released in task_svc function
     }
 
-
     mqtt_task *mt = container_of(task, mqtt_task, act_task);
     // protocol_layer *layer = (protocol_layer *)task->app_data;
+    if (MQTT_MSG_CONFIG == mblk->msg_type) return mqtt_on_config(mt, mblk);
 
     // find topic according to msg_type
     mqtt_topics *mq_topic = get_by_msg_type(mt, mblk->msg_type);
@@ -288,7 +346,12 @@ static at_error_t mqtt_on_message(active_task *task, msgblk *mblk)
         return INNER_RES_OK;    // mblk released in task_svc function
     }
 
-    // TODO handle databllk list in msgblk
+    // publish takes one buffer, datablk list copied only if more than one has data
+    datablk *db = msgblk_linearize(mblk);
+    if (NULL == db) {
+        MQTT_ERROR("ignore msg %p due to no data or linearize failed", mblk);
+        return INNER_RES_OK;    // mblk released in task_svc function
+    }
     // send msg
     int msg_id = esp_mqtt_client_publish(mt->client, mq_topic->topic,
             db->rd_ptr, datablk_length(db),
@@ -298,6 +361,7 @@ static at_error_t mqtt_on_message(active_task *task, msgblk *mblk)
     } else {
         MQTT_INFO("publish msg %p to %s, msgid %d", mblk, mq_topic->topic, msg_id);
     }
+    datablk_free(db);
     return INNER_RES_OK;    // mblk released in task_svc function
 }
 
@@ -328,6 +392,7 @@ active_task *mqtt_task_create(const char *name, int stack,
     INIT_LIST_HEAD(&mt->send_topics);
 
     mt->act_task.on_init = mqtt_on_init;
+    mt->act_task.on_fini = mqtt_on_fini;
     mt->act_task.on_loop = mqtt_on_loop;
     mt->act_task.on_message = mqtt_on_message;
     return (active_task *)mt;
@@ -342,9 +407,12 @@ void mqtt_task_delete(active_task *task)
 {
     if (NULL == task) return;
 
+    // client stopped and destroyed by mqtt_on_fini
+    if (INNER_RES_OK != task->task_stop(task, QUEUE_WAIT_FOREVER)) {
+        MQTT_ERROR("task %s not stopped, leaked", task->name);
+        return;
+    }
     mqtt_task *mt = container_of(task, mqtt_task, act_task);
-    esp_mqtt_client_stop(mt->client);
-    esp_mqtt_client_destroy(mt->client);
     mqtt_topics *mq_topic = NULL, *temp = NULL;
     if (!list_empty(&mt->recv_topics)) {
         list_for_each_entry_safe(mq_topic, temp, &mt->recv_topics, node) {
@@ -15,11 +15,17 @@
 #include "esp_event.h"
 #include "nvs.h"
 #include "nvs_flash.h"
+#include "esp_console.h"
 // #include "esp_task_wdt.h"
 
 #include "linux_macros.h"
+#include "mem_blk.h"
 #include "data_blk.h"
+#include "msg_blk.h"
+#include "blk_track.h"
 #include "active_task.h"
+#include "timer_wheel.h"
+#include "task_executor.h"
 #include "blackboard.h"
 #include "mqtt_task.h"
 
@@ -32,6 +38,9 @@
 #define P_NUM    3
 #define C_NUM    4
 
+#define WHEEL_PRIORITY      10      // timer wheel above the tasks it drives
+#define WORKER_PRIORITY     5
+
 bool start_flag = false;
 bool run_flag = true;
 
@@ -96,6 +105,34 @@ at_error_t c_on_message(active_task *task, msgblk *mblk)
     else  return  TASK_SVC_CONTINUE;
 }
 
+static int cmd_pools(int argc, char **argv)
+{
+    memblk_pool_dump();
+    datablk_pool_dump();
+    msgblk_pool_dump();
+    blk_track_dump(BLK_TRACK_AGE_MS);
+    return 0;
+}
+
+static void start_console(void)
+{
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    repl_config.prompt = "activetask>";
+    ESP_ERROR_CHECK(esp_console_new_repl_uart(&uart_config, &repl_config, &repl));
+
+    const esp_console_cmd_t cmd = {
+        .command = "pools",
+        .help = "Show usage, peak, failures and hold time of block pools",
+        .hint = NULL,
+        .func = &cmd_pools,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&cmd));
+    esp_console_register_help_command();
+    ESP_ERROR_CHECK(esp_console_start_repl(repl));
+}
+
 void app_main()
 {
     // set log level
@@ -139,7 +176,7 @@ void app_main()
     APP_INFO("event loop created");
 
     /* Initialize the blackboard */
-    blackboard_init(128);
+    blackboard_init(128, BLACKBOARD_KEY_NUM);
     APP_INFO("blackboard init");
 
 
@@ -154,6 +191,16 @@ void app_main()
         msgblk_pool_fini();
     }
 
+    /* Start timer wheel and executor before any task begins */
+    if (INNER_RES_OK != timer_wheel_init(WHEEL_PRIORITY, 0)) {
+        APP_ERROR("failed to start timer wheel");
+    }
+    if (INNER_RES_OK != task_executor_init(0, WORKER_PRIORITY)) {
+        APP_ERROR("failed to start task executor");
+    }
+    start_console();
+    APP_INFO("console started");
+
     // char name[64] = "\0";
     // active_task *p_handler[P_NUM];
     // snprintf(name, 63, "consumer");
@@ -165,7 +212,7 @@ void app_main()
     //     snprintf(name, 63, "activetask_%d", i);
     //     p_handler[i] = active_task_create(name, 1024, 1, 1, 0, 100, 0, NULL);
     //     p_handler[i]->on_loop = p_on_loop;
-    //     p_handler[i]->next_task = c_handler;
+    //     active_task_chain(p_handler[i], c_handler);
     // }
 
     // for (int i = 0; i < P_NUM; i++) {
@@ -176,6 +223,8 @@ void app_main()
     start_flag = true;
     while (run_flag) {
         delay_ms(5000);
+        datablk_pool_trim();
+        blk_track_dump(BLK_TRACK_AGE_MS);
     }
     APP_INFO("------end------\n");
     msgblk_pool_fini();
@@ -0,0 +1,49 @@
+/***
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 22:10:00
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 22:10:00
+ * @FilePath    : /activetask/test/host/bench.h
+ * @Description : helpers of host tests and benchmarks
+ * @Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* monotonic time in ns */
+static inline long long bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int bench_cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* sort samples and get percentile pct of them */
+static inline long long bench_percentile(long long *samples, long num, int pct)
+{
+    if (0 >= num) return 0;
+    qsort(samples, num, sizeof(long long), bench_cmp_ll);
+    long idx = num * pct / 100;
+    return samples[idx < num ? idx : num - 1];
+}
+
+/* fail a test with reason */
+#define BENCH_CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "FAILED %s:%d: ", __FILE__, __LINE__); \
+        fprintf(stderr, __VA_ARGS__); \
+        exit(1); \
+    } \
+} while (0)
+
+#endif /* _BENCH_H_ */
@@ -0,0 +1,68 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 23:20:00
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 23:20:00
+ * @FilePath    : /activetask/test/host/bench_alloc.c
+ * @Description : datablk and msgblk malloc/free from 1-8 threads, built
+ *                  with magazines and with BLK_MAG_SIZE=0 as baseline
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "data_blk.h"
+#include "msg_blk.h"
+#include "blk_magazine.h"
+#include "bench.h"
+
+#define HOLD        4           // blocks held by a thread at once
+#define ROUNDS      100000      // per thread
+
+static atomic_int g_failed;
+
+static void *worker(void *arg)
+{
+    datablk *dbs[HOLD];
+    msgblk *mbs[HOLD];
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < HOLD; i++) {
+            dbs[i] = datablk_malloc(64);
+            mbs[i] = msgblk_malloc(dbs[i]);
+            if (NULL == dbs[i] || NULL == mbs[i]) atomic_fetch_add(&g_failed, 1);
+        }
+        for (int i = 0; i < HOLD; i++) {
+            msgblk_free(mbs[i]);
+            datablk_free(dbs[i]);
+        }
+    }
+    datablk_thread_flush();
+    msgblk_thread_flush();
+    return NULL;
+}
+
+static void run(int threads)
+{
+    pthread_t th[8];
+    long long start = bench_now_ns();
+    for (int i = 0; i < threads; i++) pthread_create(&th[i], NULL, worker, NULL);
+    for (int i = 0; i < threads; i++) pthread_join(th[i], NULL);
+    long long elapsed = bench_now_ns() - start;
+
+    BENCH_CHECK(0 == atomic_load(&g_failed), "%d mallocs failed\n", atomic_load(&g_failed));
+    // a malloc and a free of both blocks per op
+    long ops = (long)threads * ROUNDS * HOLD;
+    printf("magazine %d, %d threads: %6.1f ns/op\n", BLK_MAG_SIZE, threads,
+            (double)elapsed / ops);
+}
+
+int main(void)
+{
+    BENCH_CHECK(INNER_RES_OK == datablk_pool_init(0, 0, 0), "datablk pool\n");
+    BENCH_CHECK(INNER_RES_OK == msgblk_pool_init(0, 0, 0, 0, 0), "msgblk pool\n");
+    int threads[] = {1, 2, 4, 8};
+    for (int i = 0; i < 4; i++) run(threads[i]);
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 22:40:00
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 22:40:00
+ * @FilePath    : /activetask/test/host/bench_batch.c
+ * @Description : cost per message of queue_pop vs queue_pop_n, and of
+ *                  on_message vs on_message_batch of an active task
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "circ_queue.h"
+#include "active_task.h"
+#include "bench.h"
+
+#define QUEUE_LEN   256
+#define BATCH       32
+#define ITEMS       (QUEUE_LEN * 4096)  // per queue run
+#define MESSAGES    (QUEUE_LEN * 512)   // per task run
+
+static atomic_long g_handled;
+
+/* app data of a task, holding it back while its queue is filled */
+typedef struct {
+    atomic_int                      go;
+    atomic_int                  parked;
+} bench_gate;
+
+/* queue filled here, then popped one by one or batch at a time */
+static void queue_run(int batch)
+{
+    void *items[BATCH];
+    long sum = 0;
+    long long elapsed = 0;
+    circ_queue *queue = circ_queue_create(QUEUE_LEN, QUEUE_F_BLOCK);
+    BENCH_CHECK(NULL != queue, "out of memory\n");
+
+    for (long base = 0; base < ITEMS; base += QUEUE_LEN) {
+        for (long i = 1; i <= QUEUE_LEN; i++)
+            queue->queue_push(queue, (void *)(base + i), QUEUE_NO_WAIT);
+        long long start = bench_now_ns();
+        for (int got = 0; QUEUE_LEN > got; ) {
+            int num = 1;
+            if (1 == batch) {
+                BENCH_CHECK(INNER_RES_OK == queue->queue_pop(queue, &items[0], QUEUE_NO_WAIT),
+                        "queue empty after %d\n", got);
+            } else {
+                num = batch;
+                BENCH_CHECK(INNER_RES_OK == queue->queue_pop_n(queue, items, &num, QUEUE_NO_WAIT),
+                        "queue empty after %d\n", got);
+            }
+            for (int i = 0; i < num; i++) sum += (long)items[i];
+            got += num;
+        }
+        elapsed += bench_now_ns() - start;
+    }
+
+    BENCH_CHECK((long)ITEMS * (ITEMS + 1) / 2 == sum, "sum of items %ld\n", sum);
+    printf("queue pop %-8s %6.1f ns/msg\n", 1 == batch ? "single" : "batch",
+            (double)elapsed / ITEMS);
+    circ_queue_delete(queue);
+}
+
+/* task waits here while its queue is filled */
+static at_error_t on_loop(active_task *task)
+{
+    bench_gate *gate = (bench_gate *)task->app_data;
+    if (atomic_load(&gate->go)) return INNER_RES_OK;
+    atomic_store(&gate->parked, 1);
+    sched_yield();
+    return TASK_SVC_CONTINUE;
+}
+
+static at_error_t on_msg(active_task *task, msgblk *mblk)
+{
+    atomic_fetch_add_explicit(&g_handled, 1, memory_order_relaxed);
+    return INNER_RES_OK;
+}
+
+static at_error_t on_msg_batch(active_task *task, msgblk **mblks, int num)
+{
+    atomic_fetch_add_explicit(&g_handled, num, memory_order_relaxed);
+    return INNER_RES_OK;
+}
+
+/* queue of task filled here, then drained one by one or batch at a time */
+static void task_run(int batch)
+{
+    static bench_gate gates[2];
+    bench_gate *gate = &gates[1 != batch];
+    long long elapsed = 0;
+    atomic_store(&g_handled, 0);
+    // receive times out in 1 ms, so that a task blocked on empty queue parks
+    active_task *task = active_task_create(1 == batch ? "single" : "batch", 0, 1 << 16,
+            0, 0, QUEUE_LEN, 1, 0, gate);
+    BENCH_CHECK(NULL != task, "create task failed\n");
+    task->on_loop = on_loop;
+    if (1 == batch) {
+        task->on_message = on_msg;
+    } else {
+        task->on_message_batch = on_msg_batch;
+        task->batch_size = batch;
+    }
+    BENCH_CHECK(INNER_RES_OK == task->task_begin(task), "begin task failed\n");
+
+    for (long base = 0; base < MESSAGES; base += QUEUE_LEN) {
+        while (!atomic_load(&gate->parked)) sched_yield();
+        for (int i = 0; i < QUEUE_LEN; i++) {
+            msgblk *mblk = msgblk_malloc(NULL);
+            BENCH_CHECK(NULL != mblk, "no msgblk at %ld\n", base + i);
+            BENCH_CHECK(INNER_RES_OK == task->put_message(task, mblk, QUEUE_NO_WAIT),
+                    "queue full at %d\n", i);
+            msgblk_free(mblk);
+        }
+        atomic_store(&gate->parked, 0);
+        long long start = bench_now_ns();
+        atomic_store(&gate->go, 1);
+        while (base + QUEUE_LEN > atomic_load(&g_handled)) sched_yield();
+        elapsed += bench_now_ns() - start;
+        atomic_store(&gate->go, 0);
+    }
+
+    printf("task on_message%-6s %6.1f ns/msg\n", 1 == batch ? "" : "_batch",
+            (double)elapsed / MESSAGES);
+    atomic_store(&gate->go, 1);
+    task->task_stop(task, 1000);
+    active_task_delete(task);
+}
+
+int main(void)
+{
+    queue_run(1);
+    queue_run(BATCH);
+
+    BENCH_CHECK(INNER_RES_OK == datablk_pool_init(0, 0, 0), "datablk pool\n");
+    BENCH_CHECK(INNER_RES_OK == msgblk_pool_init(0, 0, 0, 0, 0), "msgblk pool\n");
+    task_run(1);
+    task_run(BATCH);
+    return 0;
+}
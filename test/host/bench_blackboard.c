@@ -0,0 +1,65 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-18 00:10:00
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-18 00:10:00
+ * @FilePath    : /activetask/test/host/bench_blackboard.c
+ * @Description : blackboard_get of 100 keys vs blackboard_get_h of their
+ *                  handles, built with FNV-1a and with BLACKBOARD_HASH_MD5
+ *                  as baseline, NVS stubbed
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "blackboard.h"
+#include "bench.h"
+
+#define KEYS        100
+#define ROUNDS      10000       // gets of every key
+
+#if defined(BLACKBOARD_HASH_MD5)
+#define HASH_NAME   "md5"
+#else
+#define HASH_NAME   "fnv1a"
+#endif /* BLACKBOARD_HASH_MD5 */
+
+static char g_keys[KEYS][16];
+static void *g_data[KEYS];
+static blackboard_handle g_handles[KEYS];
+
+int main(void)
+{
+    blackboard_init(KEYS * 64, KEYS);
+    for (int i = 0; i < KEYS; i++) {
+        snprintf(g_keys[i], sizeof(g_keys[i]), "cfg_key_%03d", i);
+        g_handles[i] = blackboard_register(g_keys[i], 16, false);
+        BENCH_CHECK(BLACKBOARD_HANDLE_INVALID != g_handles[i], "register %s failed\n", g_keys[i]);
+    }
+    for (int i = 0; i < KEYS; i++) {
+        g_data[i] = blackboard_get(g_keys[i]);
+        BENCH_CHECK(NULL != g_data[i], "%s not found\n", g_keys[i]);
+        BENCH_CHECK(0 == i || g_data[i - 1] != g_data[i], "%s got other data\n", g_keys[i]);
+        BENCH_CHECK(g_data[i] == blackboard_get_h(g_handles[i]), "handle of %s got other data\n",
+                g_keys[i]);
+    }
+    BENCH_CHECK(NULL == blackboard_get("cfg_key_none"), "got data of unknown key\n");
+
+    long sum = 0;
+    long long start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++)
+        for (int i = 0; i < KEYS; i++) sum += (long)blackboard_get(g_keys[i]);
+    long long by_key = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (int r = 0; r < ROUNDS; r++)
+        for (int i = 0; i < KEYS; i++) sum -= (long)blackboard_get_h(g_handles[i]);
+    long long by_handle = bench_now_ns() - start;
+    BENCH_CHECK(0 == sum, "key and handle got other data\n");
+
+    printf("%d keys, %-5s: blackboard_get %6.1f ns, blackboard_get_h %6.1f ns\n", KEYS,
+            HASH_NAME, (double)by_key / ((long)ROUNDS * KEYS),
+            (double)by_handle / ((long)ROUNDS * KEYS));
+    blackboard_fini();
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 23:05:00
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 23:05:00
+ * @FilePath    : /activetask/test/host/bench_burst.c
+ * @Description : bursts of messages to pooled tasks, latency of tasks all
+ *                  pinned to core 0 vs tasks stolen by idle workers
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/sysinfo.h>
+
+#include "active_task.h"
+#include "task_executor.h"
+#include "bench.h"
+
+#define WORKERS     4
+#define TASKS       8
+#define PER_TASK    4           // messages to each task in a burst
+#define BURSTS      200
+#define GAP_US      2000        // between bursts
+#define WORK_NS     20000       // busy time of a message
+
+#define MESSAGES    (BURSTS * TASKS * PER_TASK)
+
+static long long g_put_ns[MESSAGES];
+static long long g_latency[MESSAGES];
+static atomic_int g_handled;
+
+static at_error_t on_msg(active_task *task, msgblk *mblk)
+{
+    long long start = bench_now_ns();
+    g_latency[mblk->msg_type] = start - g_put_ns[mblk->msg_type];
+    while (WORK_NS > bench_now_ns() - start) ;
+    atomic_fetch_add(&g_handled, 1);
+    return INNER_RES_OK;
+}
+
+static void run(bool pinned)
+{
+    active_task *tasks[TASKS];
+    char name[16];
+    atomic_store(&g_handled, 0);
+    for (int i = 0; i < TASKS; i++) {
+        snprintf(name, sizeof(name), "burst_%d", i);
+        tasks[i] = active_task_create(name, 0, 1 << 16, 0, 0, 64, 0, 0, NULL);
+        BENCH_CHECK(NULL != tasks[i], "create task %d failed\n", i);
+        tasks[i]->on_message = on_msg;
+        tasks[i]->run_mode = TASK_RUN_POOLED;
+        tasks[i]->pinned = pinned;  // all on core 0 if pinned
+        BENCH_CHECK(INNER_RES_OK == tasks[i]->task_begin(tasks[i]), "begin task %d failed\n", i);
+    }
+
+    int seq = 0;
+    for (int b = 0; b < BURSTS; b++) {
+        for (int m = 0; m < PER_TASK; m++) {
+            for (int i = 0; i < TASKS; i++, seq++) {
+                msgblk *mblk = msgblk_malloc(NULL);
+                BENCH_CHECK(NULL != mblk, "no msgblk at %d\n", seq);
+                mblk->msg_type = seq;
+                g_put_ns[seq] = bench_now_ns();
+                BENCH_CHECK(INNER_RES_OK == tasks[i]->put_message(tasks[i], mblk, QUEUE_WAIT_FOREVER),
+                        "put message %d failed\n", seq);
+                msgblk_free(mblk);
+            }
+        }
+        usleep(GAP_US);
+    }
+    while (MESSAGES > atomic_load(&g_handled)) usleep(1000);
+
+    for (int i = 0; i < TASKS; i++) {
+        tasks[i]->task_stop(tasks[i], 1000);
+        active_task_delete(tasks[i]);
+    }
+    long long p50 = bench_percentile(g_latency, MESSAGES, 50);
+    long long p99 = bench_percentile(g_latency, MESSAGES, 99);
+    printf("%-8s p50 %8lld ns, p99 %8lld ns\n", pinned ? "pinned" : "stealing", p50, p99);
+}
+
+int main(void)
+{
+    BENCH_CHECK(INNER_RES_OK == datablk_pool_init(0, 0, 0), "datablk pool\n");
+    BENCH_CHECK(INNER_RES_OK == msgblk_pool_init(0, 0, 0, 0, 0), "msgblk pool\n");
+    BENCH_CHECK(INNER_RES_OK == task_executor_init(WORKERS, 0), "executor\n");
+    printf("%d workers on %d cpus, %d tasks, bursts of %d messages\n",
+            WORKERS, get_nprocs(), TASKS, TASKS * PER_TASK);
+    run(true);
+    run(false);
+    return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 23:55:00
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 23:55:00
+ * @FilePath    : /activetask/test/host/bench_memset.c
+ * @Description : malloc vs calloc of data and memory blocks of 64 B, 512 B
+ *                  and 4 KB, built with pool classes up to 4 KB
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "data_blk.h"
+#include "mem_blk.h"
+#include "bench.h"
+
+#define ROUNDS      1000000
+
+static double datablk_run(int size, datablk *(*alloc)(int))
+{
+    long long start = bench_now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        datablk *db = alloc(size);
+        BENCH_CHECK(NULL != db, "no datablk of %d\n", size);
+        *(volatile char *)db->wr_ptr = 1;   // written by caller
+        datablk_free(db);
+    }
+    return (double)(bench_now_ns() - start) / ROUNDS;
+}
+
+static double memblk_run(int size, void *(*alloc)(int))
+{
+    long long start = bench_now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        void *mb = alloc(size);
+        BENCH_CHECK(NULL != mb, "no memblk of %d\n", size);
+        *(volatile char *)mb = 1;
+        memblk_free(mb);
+    }
+    return (double)(bench_now_ns() - start) / ROUNDS;
+}
+
+int main(void)
+{
+    BENCH_CHECK(INNER_RES_OK == datablk_pool_init(0, 0, 0), "datablk pool\n");
+    BENCH_CHECK(INNER_RES_OK == memblk_pool_init(), "memblk pool\n");
+
+    // calloc clears the block
+    datablk *db = datablk_malloc(4096);
+    memset(db->wr_ptr, 0xA5, 4096);
+    datablk_free(db);
+    db = datablk_calloc(4096);
+    for (int i = 0; i < 4096; i++)
+        BENCH_CHECK(0 == ((unsigned char *)db->wr_ptr)[i],
+                "datablk_calloc byte %d not cleared\n", i);
+    datablk_free(db);
+
+    int sizes[] = {64, 512, 4096};
+    for (int i = 0; i < 3; i++) {
+        printf("%4d B: datablk malloc %6.1f ns, calloc %6.1f ns; "
+                "memblk malloc %6.1f ns, calloc %6.1f ns\n", sizes[i],
+                datablk_run(sizes[i], datablk_malloc), datablk_run(sizes[i], datablk_calloc),
+                memblk_run(sizes[i], memblk_malloc), memblk_run(sizes[i], memblk_calloc));
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 22:10:00
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 22:10:00
+ * @FilePath    : /activetask/test/host/bench_queue.c
+ * @Description : circ_queue under 1-8 producers and 1-4 consumers,
+ *                  throughput and push to pop latency, every item seen once
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "circ_queue.h"
+#include "bench.h"
+
+/* ring before flags had only circ_queue_create(size_t), polling in 10 ms steps */
+#ifdef QUEUE_F_BLOCK
+#define bench_queue_create(len)     circ_queue_create((len), QUEUE_F_BLOCK)
+#else
+#define bench_queue_create(len)     circ_queue_create(len)
+#define QUEUE_WAIT_FOREVER          0
+#endif /* QUEUE_F_BLOCK */
+
+#define QUEUE_LEN   64
+#ifndef ITEMS
+#define ITEMS       100000      // per producer, fewer for the polling ring
+#endif /* ITEMS */
+
+static circ_queue *g_queue;
+static long long *g_pushed_ns;  // push time of each item
+static long long *g_latency;    // pop time minus push time, by pop order
+static atomic_char *g_seen;
+static atomic_long g_popped;
+static atomic_int g_producing;
+static long g_total;
+static int g_failed;            // runs with items lost or seen twice
+
+static void *producer(void *arg)
+{
+    long base = (long)arg * ITEMS;
+    for (long i = 1; i <= ITEMS; i++) {
+        g_pushed_ns[base + i] = bench_now_ns();
+        g_queue->queue_push(g_queue, (void *)(base + i), QUEUE_WAIT_FOREVER);
+    }
+    atomic_fetch_sub(&g_producing, 1);
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    void *item;
+    while (atomic_load(&g_popped) < g_total) {
+        if (INNER_RES_OK != g_queue->queue_pop(g_queue, &item, 20)) {
+            // all pushed and none left, the rest were lost
+            if (0 == atomic_load(&g_producing)) break;
+            continue;
+        }
+        long id = (long)item;
+        if (0 >= id || g_total < id) continue;
+        long long lat = bench_now_ns() - g_pushed_ns[id];
+        long idx = atomic_fetch_add(&g_popped, 1);
+        if (g_total > idx) g_latency[idx] = lat;
+        atomic_fetch_add(&g_seen[id], 1);
+    }
+    return NULL;
+}
+
+static void run(int prod, int cons)
+{
+    g_total = (long)prod * ITEMS;
+    g_pushed_ns = calloc(g_total + 1, sizeof(long long));
+    g_latency = calloc(g_total, sizeof(long long));
+    g_seen = calloc(g_total + 1, sizeof(atomic_char));
+    atomic_store(&g_popped, 0);
+    atomic_store(&g_producing, prod);
+    g_queue = bench_queue_create(QUEUE_LEN);
+    BENCH_CHECK(NULL != g_queue && NULL != g_pushed_ns && NULL != g_latency && NULL != g_seen,
+            "out of memory\n");
+
+    pthread_t th[12];
+    long long start = bench_now_ns();
+    for (long i = 0; i < cons; i++) pthread_create(&th[prod + i], NULL, consumer, NULL);
+    for (long i = 0; i < prod; i++) pthread_create(&th[i], NULL, producer, (void *)i);
+    for (int i = 0; i < prod + cons; i++) pthread_join(th[i], NULL);
+    long long elapsed = bench_now_ns() - start;
+
+    // report broken runs instead of stopping, so that old rings can be compared
+    long bad = 0;
+    for (long i = 1; i <= g_total; i++) bad += 1 != g_seen[i];
+    long popped = atomic_load(&g_popped);
+    if (popped > g_total) popped = g_total;
+    long long p50 = bench_percentile(g_latency, popped, 50);
+    long long p99 = bench_percentile(g_latency, popped, 99);
+    printf("%d producers %d consumers: %6.2f Mops/s, p50 %8lld ns, p99 %8lld ns",
+            prod, cons, g_total * 1e3 / elapsed, p50, p99);
+    if (0 < bad) printf(", %ld items lost or seen twice", bad);
+    printf("\n");
+    fflush(stdout);
+    g_failed += 0 < bad;
+
+    circ_queue_delete(g_queue);
+    free(g_pushed_ns);
+    free(g_latency);
+    free(g_seen);
+}
+
+int main(void)
+{
+    int prods[] = {1, 2, 4, 8};
+    int conss[] = {1, 2, 4};
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < 3; j++) run(prods[i], conss[j]);
+    BENCH_CHECK(0 == g_failed, "%d runs lost or duplicated items\n", g_failed);
+    return 0;
+}
@@ -0,0 +1,13 @@
+/***
+ * @FilePath    : /activetask/test/host/stub/esp_log.h
+ * @Description : ESP log macros for host builds, logs dropped
+ */
+#ifndef _STUB_ESP_LOG_H_
+#define _STUB_ESP_LOG_H_
+
+#define ESP_LOGD(tag, fmt, ...)     do {} while (0)
+#define ESP_LOGI(tag, fmt, ...)     do {} while (0)
+#define ESP_LOGW(tag, fmt, ...)     do {} while (0)
+#define ESP_LOGE(tag, fmt, ...)     do {} while (0)
+
+#endif /* _STUB_ESP_LOG_H_ */
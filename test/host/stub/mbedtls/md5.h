@@ -0,0 +1,41 @@
+/***
+ * @FilePath    : /activetask/test/host/stub/mbedtls/md5.h
+ * @Description : mbedtls MD5 for host builds, done by OpenSSL, link -lcrypto
+ */
+#ifndef _STUB_MBEDTLS_MD5_H_
+#define _STUB_MBEDTLS_MD5_H_
+
+#include <stddef.h>
+#include <openssl/evp.h>
+
+typedef struct {
+    EVP_MD_CTX                    *evp;
+} mbedtls_md5_context;
+
+static inline void mbedtls_md5_init(mbedtls_md5_context *ctx)
+{
+    ctx->evp = EVP_MD_CTX_new();
+}
+
+static inline int mbedtls_md5_starts(mbedtls_md5_context *ctx)
+{
+    return 1 == EVP_DigestInit_ex(ctx->evp, EVP_md5(), NULL) ? 0 : -1;
+}
+
+static inline int mbedtls_md5_update(mbedtls_md5_context *ctx,
+        const unsigned char *input, size_t ilen)
+{
+    return 1 == EVP_DigestUpdate(ctx->evp, input, ilen) ? 0 : -1;
+}
+
+static inline int mbedtls_md5_finish(mbedtls_md5_context *ctx, unsigned char output[16])
+{
+    return 1 == EVP_DigestFinal_ex(ctx->evp, output, NULL) ? 0 : -1;
+}
+
+static inline void mbedtls_md5_free(mbedtls_md5_context *ctx)
+{
+    EVP_MD_CTX_free(ctx->evp);
+}
+
+#endif /* _STUB_MBEDTLS_MD5_H_ */
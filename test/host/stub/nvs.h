@@ -0,0 +1,70 @@
+/***
+ * @FilePath    : /activetask/test/host/stub/nvs.h
+ * @Description : NVS for host builds, always empty and writes dropped
+ */
+#ifndef _STUB_NVS_H_
+#define _STUB_NVS_H_
+
+#include <stddef.h>
+
+typedef int esp_err_t;
+typedef unsigned int nvs_handle_t;
+typedef void *nvs_iterator_t;
+
+typedef struct {
+    char                       key[16];
+} nvs_entry_info_t;
+
+#define ESP_OK                  0
+#define ESP_ERR_NVS_NOT_FOUND   0x1102
+#define NVS_READWRITE           1
+#define NVS_TYPE_BLOB           0x42
+#define NVS_DEFAULT_PART_NAME   "nvs"
+#define ESP_ERROR_CHECK(x)      (void)(x)
+
+static inline esp_err_t nvs_open(const char *name, int mode, nvs_handle_t *handle)
+{
+    *handle = 1;
+    return ESP_OK;
+}
+
+static inline void nvs_close(nvs_handle_t handle) {}
+
+static inline esp_err_t nvs_entry_find(const char *part, const char *name, int type,
+        nvs_iterator_t *it)
+{
+    *it = NULL;
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+static inline void nvs_release_iterator(nvs_iterator_t it) {}
+
+static inline esp_err_t nvs_entry_info(nvs_iterator_t it, nvs_entry_info_t *info)
+{
+    return ESP_OK;
+}
+
+static inline esp_err_t nvs_entry_next(nvs_iterator_t *it)
+{
+    *it = NULL;
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+static inline esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value,
+        size_t *len)
+{
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+static inline esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value,
+        size_t len)
+{
+    return ESP_OK;
+}
+
+static inline esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+#endif /* _STUB_NVS_H_ */
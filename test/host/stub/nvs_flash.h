@@ -0,0 +1,20 @@
+/***
+ * @FilePath    : /activetask/test/host/stub/nvs_flash.h
+ * @Description : NVS flash for host builds
+ */
+#ifndef _STUB_NVS_FLASH_H_
+#define _STUB_NVS_FLASH_H_
+
+#include "nvs.h"
+
+static inline esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+static inline esp_err_t nvs_flash_erase(void)
+{
+    return ESP_OK;
+}
+
+#endif /* _STUB_NVS_FLASH_H_ */
@@ -0,0 +1,98 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-18 00:40:00
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-18 00:40:00
+ * @FilePath    : /activetask/test/host/test_blackboard_notify.c
+ * @Description : blackboard notices of a stub task, a burst of writes
+ *                  coalesced into one, none while stopped or after
+ *                  unsubscribe, NVS stubbed
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "blackboard.h"
+#include "bench.h"
+
+#define MSG_NOTICE  (-2)
+#define WRITES      100
+
+static msgblk *g_queued[16];
+static int g_queued_num;
+
+/* put_message of stub task, keeps msg blocks to check */
+static at_error_t stub_put(active_task *task, msgblk *mblk, int wait_ms)
+{
+    if (16 == g_queued_num) return OPR_WAIT_TIMEOUT;     // as a full queue
+    msgblk_ref(mblk);
+    g_queued[g_queued_num++] = mblk;
+    return INNER_RES_OK;
+}
+
+/* take the only notice queued */
+static void take(blackboard_notice *notice)
+{
+    BENCH_CHECK(1 == g_queued_num, "%d notices queued\n", g_queued_num);
+    BENCH_CHECK(MSG_NOTICE == g_queued[0]->msg_type, "msg type %d\n", g_queued[0]->msg_type);
+    BENCH_CHECK(INNER_RES_OK == blackboard_notify_take(g_queued[0], notice), "take failed\n");
+    msgblk_free(g_queued[0]);
+    g_queued_num = 0;
+}
+
+int main(void)
+{
+    BENCH_CHECK(INNER_RES_OK == datablk_pool_init(0, 0, 0), "datablk pool\n");
+    BENCH_CHECK(INNER_RES_OK == msgblk_pool_init(0, 0, 0, 0, 0), "msgblk pool\n");
+    blackboard_init(256, 4);
+    blackboard_handle h = blackboard_register("uri", 32, false);
+    BENCH_CHECK(BLACKBOARD_HANDLE_INVALID != h, "register failed\n");
+
+    active_task task = {0};
+    task.name = "stub";
+    task.put_message = stub_put;
+    atomic_init(&task.run_state, TASK_STATE_RUNNING);
+    BENCH_CHECK(INNER_RES_OK == blackboard_write(h, "before", 7), "write failed\n");
+    BENCH_CHECK(0 == g_queued_num, "notice before subscribe\n");
+    BENCH_CHECK(INNER_RES_OK == blackboard_subscribe(h, &task, MSG_NOTICE), "subscribe failed\n");
+
+    // a burst coalesced, the notice taken after it tells the last version
+    char buf[32];
+    for (int i = 0; i < WRITES; i++) {
+        int len = snprintf(buf, sizeof(buf), "mqtt://host%d", i) + 1;
+        BENCH_CHECK(INNER_RES_OK == blackboard_write(h, buf, len), "write %d failed\n", i);
+    }
+    blackboard_notice notice;
+    take(&notice);
+    BENCH_CHECK(h == notice.handle, "notice of handle %d\n", notice.handle);
+    BENCH_CHECK(WRITES + 1 == notice.version, "notice of version %u\n", notice.version);
+    BENCH_CHECK(INNER_RES_OK == blackboard_read(h, buf, sizeof(buf)), "read failed\n");
+    snprintf(buf + sizeof(buf) / 2, sizeof(buf) / 2, "mqtt://host%d", WRITES - 1);
+    BENCH_CHECK(0 == strcmp(buf, buf + sizeof(buf) / 2), "read %s\n", buf);
+
+    // notice taken, next write notifies again
+    BENCH_CHECK(INNER_RES_OK == blackboard_write(h, "x", 2), "write failed\n");
+    take(&notice);
+    BENCH_CHECK(WRITES + 2 == notice.version, "notice of version %u\n", notice.version);
+
+    // a stopped task is not notified, it reads the board when begun again
+    atomic_store(&task.run_state, TASK_STATE_STOPPED);
+    BENCH_CHECK(INNER_RES_OK == blackboard_write(h, "s", 2), "write failed\n");
+    BENCH_CHECK(0 == g_queued_num, "notice while stopped\n");
+    atomic_store(&task.run_state, TASK_STATE_RUNNING);
+
+    blackboard_unsubscribe(h, &task);
+    BENCH_CHECK(INNER_RES_OK == blackboard_write(h, "y", 2), "write failed\n");
+    BENCH_CHECK(0 == g_queued_num, "notice after unsubscribe\n");
+
+    msgblk *other = msgblk_malloc_inline(3);
+    BENCH_CHECK(NULL != other, "no msgblk\n");
+    BENCH_CHECK(INNER_INVAILD_PARAM == blackboard_notify_take(other, &notice),
+            "took notice from other msg\n");
+    msgblk_free(other);
+
+    blackboard_fini();
+    printf("%d writes, one notice of version %d, none while stopped or after unsubscribe, "
+            "passed\n", WRITES, WRITES + 1);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-18 00:30:00
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-18 00:30:00
+ * @FilePath    : /activetask/test/host/test_blackboard_seqlock.c
+ * @Description : 2 writers and 3 readers of a 128 byte blackboard entry,
+ *                  no reader sees a torn snapshot, NVS stubbed
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "blackboard.h"
+#include "bench.h"
+
+#define WRITERS     2
+#define READERS     3
+#define WRITES      300000      // per writer
+
+/* every word written with the same value, any mix of two writes is torn */
+typedef struct {
+    long                          v[128 / sizeof(long)];
+} snapshot;
+
+#define WORDS       (int)(sizeof(((snapshot *)0)->v) / sizeof(long))
+
+static blackboard_handle g_handle;
+static atomic_int g_writing;
+static atomic_long g_reads;
+static atomic_long g_torn;
+
+static void *writer(void *arg)
+{
+    long base = (long)arg;
+    snapshot s;
+    for (long i = 0; i < WRITES; i++) {
+        for (int j = 0; j < WORDS; j++) s.v[j] = base + i;
+        BENCH_CHECK(INNER_RES_OK == blackboard_write(g_handle, &s, sizeof(s)),
+                "write %ld failed\n", i);
+    }
+    atomic_fetch_sub(&g_writing, 1);
+    return NULL;
+}
+
+static void *reader(void *arg)
+{
+    snapshot s;
+    while (0 < atomic_load(&g_writing)) {
+        BENCH_CHECK(INNER_RES_OK == blackboard_read(g_handle, &s, sizeof(s)), "read failed\n");
+        for (int j = 1; j < WORDS; j++) {
+            if (s.v[j] != s.v[0]) {
+                atomic_fetch_add(&g_torn, 1);
+                break;
+            }
+        }
+        atomic_fetch_add_explicit(&g_reads, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    blackboard_init(1024, 4);
+    g_handle = blackboard_register("snapshot", sizeof(snapshot), false);
+    BENCH_CHECK(BLACKBOARD_HANDLE_INVALID != g_handle, "register failed\n");
+
+    pthread_t wr[WRITERS], rd[READERS];
+    atomic_store(&g_writing, WRITERS);
+    for (int i = 0; i < READERS; i++) pthread_create(&rd[i], NULL, reader, NULL);
+    for (int i = 0; i < WRITERS; i++)
+        pthread_create(&wr[i], NULL, writer, (void *)(i * 1000000000L));
+    for (int i = 0; i < WRITERS; i++) pthread_join(wr[i], NULL);
+    for (int i = 0; i < READERS; i++) pthread_join(rd[i], NULL);
+
+    BENCH_CHECK(0 == atomic_load(&g_torn), "%ld of %ld reads torn\n",
+            atomic_load(&g_torn), atomic_load(&g_reads));
+
+    // longer than data, or of no data, rejected
+    snapshot s;
+    BENCH_CHECK(INNER_INVAILD_PARAM == blackboard_read(g_handle, &s, sizeof(s) + 1),
+            "read past data accepted\n");
+    BENCH_CHECK(BB_KEY_NOT_EXIST == blackboard_write(g_handle + 1, &s, 1),
+            "write of unknown handle accepted\n");
+
+    printf("%d writers, %d readers: %ld reads, none torn, passed\n", WRITERS, READERS,
+            atomic_load(&g_reads));
+    blackboard_fini();
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-17 23:40:00
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-17 23:40:00
+ * @FilePath    : /activetask/test/host/test_lf_stack.c
+ * @Description : lf_stack under 8 threads popping and pushing back single
+ *                  nodes and chains, no node held twice and none lost
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "lf_stack.h"
+#include "bench.h"
+
+#define NODES       64
+#define THREADS     8
+#define ROUNDS      500000      // per thread
+#define CHAIN       3           // most nodes popped before pushed back
+
+static lf_stack g_stack;
+static lf_node g_nodes[NODES];
+static atomic_int g_holders[NODES];
+
+static void *worker(void *arg)
+{
+    struct llist_node *held[CHAIN];
+    for (long r = 0; r < ROUNDS; r++) {
+        int num = 0;
+        for (int want = 1 + r % CHAIN; num < want; num++) {
+            if (NULL == (held[num] = lf_stack_pop(&g_stack))) break;
+            int k = container_of(held[num], lf_node, node) - g_nodes;
+            BENCH_CHECK(0 == atomic_fetch_add(&g_holders[k], 1), "node %d popped twice\n", k);
+        }
+        if (0 == num) continue;
+        for (int i = 0; i < num; i++)
+            atomic_fetch_sub(&g_holders[container_of(held[i], lf_node, node) - g_nodes], 1);
+        // push back as a chain from held[num - 1] to held[0]
+        for (int i = num - 1; 0 < i; i--) held[i]->next = held[i - 1];
+        lf_stack_push_batch(&g_stack, held[num - 1], held[0]);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    lf_stack_init(&g_stack);
+    for (int i = 0; i < NODES; i++) {
+        BENCH_CHECK(lf_node_register(&g_nodes[i]), "register node %d failed\n", i);
+        lf_stack_push(&g_stack, &g_nodes[i].node);
+    }
+
+    pthread_t th[THREADS];
+    long long start = bench_now_ns();
+    for (int i = 0; i < THREADS; i++) pthread_create(&th[i], NULL, worker, NULL);
+    for (int i = 0; i < THREADS; i++) pthread_join(th[i], NULL);
+    long long elapsed = bench_now_ns() - start;
+
+    int count = 0;
+    while (NULL != lf_stack_pop(&g_stack)) count++;
+    BENCH_CHECK(NODES == count, "%d nodes left of %d\n", count, NODES);
+    BENCH_CHECK(atomic_is_lock_free(&g_stack.top), "top is not lock-free\n");
+    BENCH_CHECK(lf_stack_idle(&g_stack), "%u pops left in flight\n", atomic_load(&g_stack.pops));
+
+    // slot cleared when index given back, node can register again
+    unsigned int idx = g_nodes[0].idx;
+    lf_node_unregister(&g_nodes[0]);
+    BENCH_CHECK(NULL == lf_node_at(idx), "slot %u not cleared\n", idx);
+    BENCH_CHECK(lf_node_register(&g_nodes[0]) && &g_nodes[0] == lf_node_at(g_nodes[0].idx),
+            "register again failed\n");
+
+    printf("%d threads, %d nodes: %6.1f ns/round, passed\n", THREADS, NODES,
+            (double)elapsed / ((long)THREADS * ROUNDS));
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-18 01:00:00
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-18 01:00:00
+ * @FilePath    : /activetask/test/host/test_route.c
+ * @Description : active_task_route walking routes while another thread adds
+ *                  and deletes one, no route lost and upstreams counted right
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "active_task.h"
+#include "bench.h"
+
+#define WALKS       1000000
+#define CHANGES     100000
+
+static active_task *g_source;
+static active_task *g_stay;         // routed all the time
+static active_task *g_flap;         // route added and deleted
+static atomic_long g_stay_got;
+static atomic_int g_walking;
+
+/* put_message of targets, counts only */
+static at_error_t count_put(active_task *task, msgblk *mblk, int wait_ms)
+{
+    if (g_stay == task) atomic_fetch_add_explicit(&g_stay_got, 1, memory_order_relaxed);
+    return INNER_RES_OK;
+}
+
+static void *walker(void *arg)
+{
+    msgblk mblk = {0};
+    for (long i = 0; i < WALKS; i++)
+        BENCH_CHECK(INNER_RES_OK == active_task_route(g_source, &mblk, QUEUE_NO_WAIT),
+                "walk %ld failed\n", i);
+    atomic_store(&g_walking, 0);
+    return NULL;
+}
+
+static active_task *target(const char *name)
+{
+    active_task *task = active_task_create(name, 0, 1 << 16, 0, 0, 8, 0, 0, NULL);
+    BENCH_CHECK(NULL != task, "create %s failed\n", name);
+    task->put_message = count_put;
+    return task;
+}
+
+int main(void)
+{
+    g_source = active_task_create("source", 0, 1 << 16, 0, 0, 8, 0, 0, NULL);
+    BENCH_CHECK(NULL != g_source, "create source failed\n");
+    g_stay = target("stay");
+    g_flap = target("flap");
+    BENCH_CHECK(INNER_RES_OK == active_task_add_route(g_source, TASK_ROUTE_ANY, g_stay,
+            TASK_QUEUE_NORMAL), "add route failed\n");
+
+    pthread_t th;
+    atomic_store(&g_walking, 1);
+    pthread_create(&th, NULL, walker, NULL);
+    long changes = 0;
+    for (; changes < CHANGES || atomic_load(&g_walking); changes++) {
+        BENCH_CHECK(INNER_RES_OK == active_task_add_route(g_source, TASK_ROUTE_ANY, g_flap,
+                TASK_QUEUE_NORMAL), "add route failed\n");
+        active_task_del_route(g_source, TASK_ROUTE_ANY, g_flap);
+    }
+    pthread_join(th, NULL);
+
+    BENCH_CHECK(WALKS == atomic_load(&g_stay_got), "%ld of %d walks reached stay\n",
+            atomic_load(&g_stay_got), WALKS);
+    BENCH_CHECK(1 == atomic_load(&g_stay->upstream_num) && 0 == atomic_load(&g_flap->upstream_num),
+            "upstreams %d and %d\n", atomic_load(&g_stay->upstream_num),
+            atomic_load(&g_flap->upstream_num));
+    BENCH_CHECK(active_task_has_next(g_source), "route to stay lost\n");
+
+    printf("%d walks, %ld route changes, passed\n", WALKS, changes);
+    active_task_delete(g_source);
+    active_task_delete(g_stay);
+    active_task_delete(g_flap);
+    return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * @Author      : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @Date        : 2026-10-18 02:10:00
+ * @LastEditors : kevin.z.y <kevin.cn.zhengyang@gmail.com>
+ * @LastEditTime: 2026-10-18 02:10:00
+ * @FilePath    : /activetask/test/host/test_task_stop.c
+ * @Description : task stopped and begun again while upstreams put into it,
+ *                  puts refused once stopped, queues kept till none in flight
+ * Copyright (c) 2022 by Zheng, Yang, All Rights Reserved.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "active_task.h"
+#include "bench.h"
+
+#define PRODUCERS   4
+#define ROUNDS      50
+#define WORK_NS     20000
+
+static active_task *g_source;
+static active_task *g_target;
+static atomic_int g_running;
+static atomic_long g_put, g_refused, g_handled;
+
+/* slow consumer, so that producers block on a full queue */
+static at_error_t on_msg(active_task *task, msgblk *mblk)
+{
+    long long start = bench_now_ns();
+    while (WORK_NS > bench_now_ns() - start) ;
+    atomic_fetch_add(&g_handled, 1);
+    return INNER_RES_OK;
+}
+
+static void *producer(void *arg)
+{
+    while (atomic_load(&g_running)) {
+        msgblk *mblk = msgblk_malloc(NULL);
+        BENCH_CHECK(NULL != mblk, "no msgblk\n");
+        at_error_t res = g_source->put_message_next(g_source, mblk, QUEUE_WAIT_FOREVER);
+        msgblk_free(mblk);
+        if (TASK_NOT_RUNNING == res) {
+            atomic_fetch_add(&g_refused, 1);
+            sched_yield();
+        } else {
+            BENCH_CHECK(INNER_RES_OK == res, "put failed %x\n", res);
+            atomic_fetch_add(&g_put, 1);
+        }
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    BENCH_CHECK(INNER_RES_OK == datablk_pool_init(0, 0, 0), "datablk pool\n");
+    BENCH_CHECK(INNER_RES_OK == msgblk_pool_init(0, 0, 0, 0, 0), "msgblk pool\n");
+    g_source = active_task_create("source", 0, 1 << 16, 0, 0, 8, 0, 0, NULL);
+    g_target = active_task_create("target", 0, 1 << 16, 0, 0, 8, 0, 0, NULL);
+    BENCH_CHECK(NULL != g_source && NULL != g_target, "create failed\n");
+    g_target->on_message = on_msg;
+    BENCH_CHECK(INNER_RES_OK == active_task_chain(g_source, g_target), "chain failed\n");
+    BENCH_CHECK(INNER_RES_OK == g_target->task_begin(g_target), "begin failed\n");
+
+    pthread_t th[PRODUCERS];
+    atomic_store(&g_running, 1);
+    for (int i = 0; i < PRODUCERS; i++) pthread_create(&th[i], NULL, producer, NULL);
+    for (int r = 0; r < ROUNDS; r++) {
+        usleep(2000);
+        BENCH_CHECK(INNER_RES_OK == g_target->task_stop(g_target, QUEUE_WAIT_FOREVER),
+                "stop %d failed\n", r);
+        msgblk *mblk = msgblk_malloc(NULL);
+        BENCH_CHECK(TASK_NOT_RUNNING == g_source->put_message_next(g_source, mblk, QUEUE_NO_WAIT),
+                "put taken while stopped\n");
+        msgblk_free(mblk);
+        usleep(1000);
+        BENCH_CHECK(INNER_RES_OK == g_target->task_begin(g_target), "begin %d failed\n", r);
+    }
+    atomic_store(&g_running, 0);
+    for (int i = 0; i < PRODUCERS; i++) pthread_join(th[i], NULL);
+
+    BENCH_CHECK(0 < atomic_load(&g_put) && 0 < atomic_load(&g_refused),
+            "%ld put, %ld refused\n", atomic_load(&g_put), atomic_load(&g_refused));
+    BENCH_CHECK(atomic_load(&g_handled) <= atomic_load(&g_put), "%ld handled of %ld put\n",
+            atomic_load(&g_handled), atomic_load(&g_put));
+
+    // target linked by source can't go first, unlinked once source deleted
+    active_task_delete(g_target);
+    BENCH_CHECK(1 == atomic_load(&g_target->upstream_num), "target deleted while linked\n");
+    active_task_delete(g_source);
+    BENCH_CHECK(0 == atomic_load(&g_target->upstream_num), "target still linked\n");
+    printf("%d stops, %ld put, %ld refused, %ld handled, passed\n", ROUNDS,
+            atomic_load(&g_put), atomic_load(&g_refused), atomic_load(&g_handled));
+    active_task_delete(g_target);
+    return 0;
+}